@@ -0,0 +1,1377 @@
+/**
+ * @file task_bench.cpp
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 性能测试
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ * 用法: task_bench [--csv] [测试组...]
+ * 测试组: spawn table exit wake affinity pool future timer graph churn alloc，不指定时全部执行
+ * 默认输出JSON，--csv输出CSV，结果写到标准输出，进度写到标准错误
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <ctime>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <stdexcept>
+#include "../src/task.h"
+#include "../src/task_pool.h"
+#include "../src/task_timer.h"
+#include "../src/task_graph.h"
+
+using namespace wotsen;
+
+namespace
+{
+
+using bench_clock = std::chrono::steady_clock;
+
+///< 任务数量上限
+#define BENCH_MAX_TASKS 8192
+
+///< 任务管理检测周期
+#define BENCH_MANAGE_PERIOD TASK_MS(10)
+
+/**
+ * @brief 测试结果
+ *
+ */
+struct BenchResult
+{
+	std::string group;	///< 测试组
+	std::string name;	///< 测试项
+	std::string param;	///< 参数
+	std::string unit;	///< 单位
+	size_t samples;		///< 样本数
+	double mean;		///< 平均值
+	double p50;			///< 中位数
+	double p99;			///< 99分位
+	double max;			///< 最大值
+};
+
+std::vector<BenchResult> results;
+std::vector<std::string> groups;
+std::string current;
+
+///< 当前线程的堆分配次数，由本文件替换的operator new计数
+thread_local uint64_t allocs = 0;
+
+// 距start的耗时(ns)
+double elapsed_ns(const bench_clock::time_point &start)
+{
+	return std::chrono::duration<double, std::nano>(bench_clock::now() - start).count();
+}
+
+// 记录样本统计
+void report(const std::string &name, const std::string &param, const std::string &unit, std::vector<double> samples)
+{
+	BenchResult result{current, name, param, unit, samples.size(), 0, 0, 0, 0};
+
+	if (!samples.empty())
+	{
+		std::sort(samples.begin(), samples.end());
+
+		for (auto &item : samples) result.mean += item;
+
+		result.mean /= samples.size();
+		result.p50 = samples[samples.size() / 2];
+		result.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+		result.max = samples.back();
+	}
+
+	fprintf(stderr, "  %-12s %-28s %-10s mean %12.1f p50 %12.1f p99 %12.1f %s\n",
+			current.c_str(), name.c_str(), param.c_str(), result.mean, result.p50, result.p99, unit.c_str());
+
+	results.push_back(result);
+}
+
+// 记录单个值
+void report(const std::string &name, const std::string &param, const std::string &unit, const double &value)
+{
+	report(name, param, unit, std::vector<double>{value});
+}
+
+// 测试组是否需要执行
+bool enabled(const char *group)
+{
+	current = group;
+
+	return groups.empty() || groups.end() != std::find(groups.begin(), groups.end(), group);
+}
+
+// 等待任务管理清理已结束的任务
+void settle(void)
+{
+	std::this_thread::sleep_for(BENCH_MANAGE_PERIOD * 5);
+}
+
+TaskRegisterInfo bench_reg_info(const char *name)
+{
+	TaskRegisterInfo reg_info;
+
+	reg_info.task_attr.task_name = name;
+	reg_info.task_attr.stacksize = TASK_STACKSIZE(64);
+	reg_info.alive_time = TASK_SEC(10);
+	reg_info.e_action = e_task_ignore;
+
+	return reg_info;
+}
+
+// 忙等ns纳秒，模拟计算任务
+void busy_ns(long long ns)
+{
+	auto deadline = bench_clock::now() + std::chrono::nanoseconds(ns);
+
+	while (bench_clock::now() < deadline);
+}
+
+// 心跳直到结束
+void spin_alive(std::atomic<bool> *started)
+{
+	while (Task::self().alive())
+	{
+		if (started) started->store(true, std::memory_order_release);
+
+		std::this_thread::yield();
+	}
+}
+
+/**
+ * @brief 任务创建
+ *
+ */
+void bench_spawn(void)
+{
+	TaskAttribute attr;
+	std::vector<double> samples;
+
+	attr.task_name = "bench spawn";
+	attr.stacksize = TASK_STACKSIZE(64);
+
+	// 线程缓存命中
+	for (int i = 0; i < 2000; i++)
+	{
+		auto start = bench_clock::now();
+
+		new_task(attr, []() {}).fut.get();
+		samples.push_back(elapsed_ns(start));
+	}
+
+	report("new_task", "cached", "ns", samples);
+
+	// 不缓存，每次创建线程
+	set_task_cache(0, TASK_MS(10000));
+	samples.clear();
+
+	for (int i = 0; i < 500; i++)
+	{
+		auto start = bench_clock::now();
+
+		new_task(attr, []() {}).fut.get();
+		samples.push_back(elapsed_ns(start));
+	}
+
+	report("new_task", "uncached", "ns", samples);
+
+	// 多个线程同时创建，线程缓存锁不在pthread_create期间持有，创建互不串行
+	for (int creators : {1, 2, 4})
+	{
+		std::vector<std::thread> threads;
+		auto start = bench_clock::now();
+
+		for (int i = 0; i < creators; i++)
+		{
+			threads.emplace_back([&attr]() {
+				for (int j = 0; j < 200; j++) new_task(attr, []() {}).fut.get();
+			});
+		}
+
+		for (auto &item : threads) item.join();
+
+		report("new_task_parallel", std::to_string(creators), "ns", elapsed_ns(start) / (200 * creators));
+	}
+
+	// 恢复默认配置
+	set_task_cache(32, TASK_MS(10000));
+
+	TaskRegisterInfo reg_info = bench_reg_info("bench register");
+
+	samples.clear();
+
+	for (int i = 0; i < 1000; i++)
+	{
+		auto start = bench_clock::now();
+		auto key = Task::register_task(reg_info, []() {});
+
+		samples.push_back(elapsed_ns(start));
+		Task::task_run(key.tid);
+		key.fut.get();
+	}
+
+	report("register_task", "call", "ns", samples);
+	settle();
+
+	samples.clear();
+
+	for (int i = 0; i < 1000; i++)
+	{
+		auto start = bench_clock::now();
+		auto key = Task::register_task(reg_info, []() {});
+
+		Task::task_run(key.tid);
+		key.fut.get();
+		samples.push_back(elapsed_ns(start));
+	}
+
+	report("register_task", "round_trip", "ns", samples);
+	settle();
+
+	// 1000个任务逐个创建与批量创建
+	std::vector<TaskKey<void>> keys;
+	auto start = bench_clock::now();
+
+	for (int i = 0; i < 1000; i++) keys.push_back(Task::register_task(reg_info, []() {}));
+
+	report("register_task", "x1000", "ns", elapsed_ns(start));
+
+	for (auto &item : keys) Task::task_run(item.tid);
+	for (auto &item : keys) item.fut.get();
+
+	settle();
+
+	std::vector<TaskRegisterInfo> reg_infos(1000, reg_info);
+
+	start = bench_clock::now();
+
+	auto batch = Task::register_tasks(reg_infos, [](size_t) {});
+
+	report("register_tasks", "x1000", "ns", elapsed_ns(start));
+
+	for (auto &item : batch) Task::task_run(item.tid);
+	for (auto &item : batch) item.fut.get();
+
+	settle();
+}
+
+// 每批调用fn count次，返回每批的平均耗时
+template <typename F>
+std::vector<double> per_call(const int &batches, const int &count, F &&fn)
+{
+	std::vector<double> samples;
+
+	for (int i = 0; i < batches; i++)
+	{
+		auto start = bench_clock::now();
+
+		for (int j = 0; j < count; j++) fn();
+
+		samples.push_back(elapsed_ns(start) / count);
+	}
+
+	return samples;
+}
+
+/**
+ * @brief 对照组：原任务表，描述符共享指针数组
+ *
+ */
+struct ScanDesc
+{
+	uint64_t tid;				///< 任务id
+	TaskRegisterInfo reg_info;	///< 注册信息，描述符大小与原实现相近
+	std::mutex mtx;				///< 任务锁
+};
+
+// 对照组：与原Task::search_task一致，逐个拷贝共享指针线性查找
+std::shared_ptr<ScanDesc> scan_search(const std::vector<std::shared_ptr<ScanDesc>> &tasks, const uint64_t &tid)
+{
+	for (auto item : tasks)
+	{
+		if (tid == item->tid) return item;
+	}
+
+	return nullptr;
+}
+
+/**
+ * @brief 不同任务数量下的心跳和任务管理检测耗时，与线性查找对比
+ *
+ */
+void bench_table(void)
+{
+	for (uint32_t size : {1u, 16u, 256u, 1024u, 4096u})
+	{
+		std::string param = std::to_string(size);
+		TaskRegisterInfo reg_info = bench_reg_info("bench filler");
+
+		// 陪测任务低频心跳
+		std::vector<TaskRegisterInfo> reg_infos(size - 1, reg_info);
+		auto fillers = Task::register_tasks(reg_infos, [](size_t) {
+			while (Task::self().alive()) std::this_thread::sleep_for(TASK_MS(50));
+		});
+
+		for (auto &item : fillers) Task::task_run(item.tid);
+
+		TaskManageStat before = Task::manage_stat();
+		auto key = Task::register_task(bench_reg_info("bench heartbeat"), [&]() {
+			uint64_t tid = Task::self().tid();
+
+			report("task_alive", param, "ns", per_call(20, 10000, [&]() { Task::task_alive(tid); }));
+			report("is_task_alive", param, "ns", per_call(20, 10000, [&]() { Task::is_task_alive(tid); }));
+			report("task_state", param, "ns", per_call(20, 10000, [&]() { Task::task_state(tid); }));
+			report("self_alive", param, "ns", per_call(20, 10000, []() { Task::self().alive(); }));
+			report("stop_requested", param, "ns", per_call(20, 10000, []() { Task::self().stop_requested(); }));
+			report("task_id_alive", param, "ns", per_call(20, 10000, []() { Task::task_alive(task_id()); }));
+		});
+
+		Task::task_run(key.tid);
+		key.fut.get();
+
+		// 同样的任务id按注册顺序放入数组，查找最后注册的任务，即原实现中心跳任务的位置
+		std::vector<std::shared_ptr<ScanDesc>> scan_tasks;
+
+		for (auto &item : fillers) scan_tasks.emplace_back(std::make_shared<ScanDesc>())->tid = item.tid;
+
+		scan_tasks.emplace_back(std::make_shared<ScanDesc>())->tid = key.tid;
+
+		uint64_t scan_tid = key.tid;
+		int scan_count = std::max<int>(100, 1000000 / size);
+
+		report("vector_scan", param, "ns", per_call(20, scan_count, [&]() {
+			auto item = scan_search(scan_tasks, scan_tid);
+
+			// 原task_alive找到后加任务锁更新心跳
+			if (item)
+			{
+				std::unique_lock<std::mutex> lock(item->mtx);
+			}
+		}));
+
+		// 至少覆盖若干检测周期
+		std::this_thread::sleep_for(BENCH_MANAGE_PERIOD * 20);
+
+		TaskManageStat after = Task::manage_stat();
+		uint64_t ticks = after.ticks - before.ticks;
+
+		if (ticks)
+		{
+			report("manage_tick", param, "ns", static_cast<double>((after.total - before.total).count()) / ticks);
+		}
+
+		Task::task_exit_all();
+		settle();
+	}
+
+	// 启动至今的单次最大耗时
+	report("manage_tick_max", "all", "ns", static_cast<double>(Task::manage_stat().max.count()));
+}
+
+/**
+ * @brief 任务结束耗时
+ *
+ */
+void bench_exit(void)
+{
+	std::vector<double> samples;
+
+	for (int i = 0; i < 200; i++)
+	{
+		std::atomic<bool> started(false);
+		auto key = Task::register_task(bench_reg_info("bench exit"), spin_alive, &started);
+
+		Task::task_run(key.tid);
+
+		while (!started.load(std::memory_order_acquire)) std::this_thread::yield();
+
+		auto start = bench_clock::now();
+
+		Task::task_exit(key.tid);
+		samples.push_back(elapsed_ns(start));
+		key.fut.wait();
+	}
+
+	report("task_exit", "running", "ns", samples);
+
+	// 阻塞在长睡眠中的任务，停止请求直接唤醒
+	samples.clear();
+
+	for (int i = 0; i < 200; i++)
+	{
+		std::atomic<bool> started(false);
+		auto key = Task::register_task(bench_reg_info("bench exit"), [&started](TaskStopToken stop) {
+			started.store(true, std::memory_order_release);
+
+			while (stop.sleep_for(TASK_SEC(10)));
+		});
+
+		Task::task_run(key.tid);
+
+		while (!started.load(std::memory_order_acquire)) std::this_thread::yield();
+
+		// 进入睡眠
+		std::this_thread::sleep_for(TASK_MS(1));
+
+		auto start = bench_clock::now();
+
+		Task::task_exit(key.tid);
+		samples.push_back(elapsed_ns(start));
+		key.fut.wait();
+	}
+
+	report("task_exit", "sleeping", "ns", samples);
+	settle();
+}
+
+/**
+ * @brief 暂停后继续的唤醒延迟
+ *
+ */
+/**
+ * @brief 暂停后继续的唤醒延迟
+ *
+ * @param name : 测试项
+ * @param resumes : 被测线程每轮循环加1
+ * @param resumed_at : 被测线程最近一轮循环的时间
+ * @param pause : 暂停被测线程
+ * @param resume : 继续被测线程
+ */
+template <typename P, typename R>
+void wake_latency(const std::string &name, std::atomic<uint64_t> &resumes, std::atomic<int64_t> &resumed_at, P &&pause, R &&resume)
+{
+	std::vector<double> samples;
+	std::vector<double> calls;
+
+	for (int i = 0; i < 200; i++)
+	{
+		pause();
+
+		// 等待进入暂停
+		std::this_thread::sleep_for(TASK_MS(2));
+
+		uint64_t count = resumes.load(std::memory_order_acquire);
+		auto start = bench_clock::now();
+
+		resume();
+		calls.push_back(elapsed_ns(start));
+
+		while (count == resumes.load(std::memory_order_acquire)) std::this_thread::yield();
+
+		samples.push_back(static_cast<double>(resumed_at.load(std::memory_order_relaxed) - start.time_since_epoch().count()));
+	}
+
+	report(name, "wake", "ns", samples);
+	report(name, "call", "ns", calls);
+}
+
+// 被测线程一轮循环
+void wake_tick(std::atomic<uint64_t> &resumes, std::atomic<int64_t> &resumed_at)
+{
+	resumed_at.store(bench_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+	resumes.fetch_add(1, std::memory_order_release);
+	std::this_thread::yield();
+}
+
+void bench_wake(void)
+{
+	std::atomic<uint64_t> resumes(0);
+	std::atomic<int64_t> resumed_at(0);
+	auto key = Task::register_task(bench_reg_info("bench wake"), [&]() {
+		while (Task::self().alive()) wake_tick(resumes, resumed_at);
+	});
+
+	Task::task_run(key.tid);
+
+	wake_latency("task_continue", resumes, resumed_at, [&]() { Task::task_wait(key.tid); },
+				 [&]() { Task::task_continue(key.tid); });
+
+	Task::task_exit(key.tid);
+	key.fut.wait();
+	settle();
+
+	// 对照组：原暂停实现，任务锁加条件变量，继续时加锁修改状态后通知
+	{
+		std::mutex mtx;
+		std::condition_variable cond;
+		bool paused = false;
+		bool quit = false;
+		std::thread worker([&]() {
+			std::unique_lock<std::mutex> lock(mtx);
+
+			while (!quit)
+			{
+				while (paused && !quit) cond.wait(lock);
+
+				lock.unlock();
+				wake_tick(resumes, resumed_at);
+				lock.lock();
+			}
+		});
+
+		wake_latency("condvar_baseline", resumes, resumed_at, [&]() {
+			std::unique_lock<std::mutex> lock(mtx);
+			paused = true;
+		}, [&]() {
+			std::unique_lock<std::mutex> lock(mtx);
+			paused = false;
+			cond.notify_one();
+		});
+
+		{
+			std::unique_lock<std::mutex> lock(mtx);
+			quit = true;
+			cond.notify_one();
+		}
+
+		worker.join();
+	}
+
+	// 对照组：暂停期间每1ms轮询一次状态
+	{
+		std::atomic<bool> paused(false);
+		std::atomic<bool> quit(false);
+		std::thread worker([&]() {
+			while (!quit.load(std::memory_order_acquire))
+			{
+				while (paused.load(std::memory_order_acquire)) std::this_thread::sleep_for(TASK_MS(1));
+
+				wake_tick(resumes, resumed_at);
+			}
+		});
+
+		wake_latency("poll_baseline", resumes, resumed_at, [&]() { paused.store(true, std::memory_order_release); },
+					 [&]() { paused.store(false, std::memory_order_release); });
+
+		quit.store(true, std::memory_order_release);
+		worker.join();
+	}
+
+	std::vector<double> calls;
+
+	// 批量暂停继续
+	std::vector<TaskRegisterInfo> reg_infos(64, bench_reg_info("bench group"));
+	auto group = Task::register_tasks(reg_infos, [](size_t) {
+		while (Task::self().alive()) std::this_thread::sleep_for(TASK_MS(1));
+	});
+	std::vector<uint64_t> tids;
+	std::vector<double> pauses;
+
+	calls.clear();
+
+	for (auto &item : group) tids.push_back(item.tid);
+
+	Task::task_continue(tids);
+
+	for (int i = 0; i < 50; i++)
+	{
+		auto start = bench_clock::now();
+
+		Task::task_wait(tids);
+		pauses.push_back(elapsed_ns(start));
+
+		std::this_thread::sleep_for(TASK_MS(2));
+
+		start = bench_clock::now();
+		Task::task_continue(tids);
+		calls.push_back(elapsed_ns(start));
+	}
+
+	report("task_wait_group", "64", "ns", pauses);
+	report("task_continue_group", "64", "ns", calls);
+
+	Task::task_exit_all();
+	settle();
+}
+
+// NUMA节点的CPU，节点不存在时为空
+std::vector<int> node_cpus(const int &node)
+{
+	std::vector<int> cpus;
+	char path[64] = {'\0'};
+	unsigned int first = 0;
+	unsigned int last = 0;
+	int c = 0;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+	FILE *fp = fopen(path, "r");
+
+	if (!fp) return cpus;
+
+	// 格式如0-3,8-11
+	while (fscanf(fp, "%u", &first) == 1)
+	{
+		last = first;
+		c = fgetc(fp);
+
+		if ('-' == c)
+		{
+			if (fscanf(fp, "%u", &last) != 1) break;
+
+			c = fgetc(fp);
+		}
+
+		for (unsigned int i = first; i <= last && i < CPU_SETSIZE; i++) cpus.push_back(i);
+
+		if (',' != c) break;
+	}
+
+	fclose(fp);
+
+	return cpus;
+}
+
+// 只包含cpu的亲和性，cpu小于0时为空集(不限制)
+cpu_set_t cpu_mask(const int &cpu)
+{
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+
+	if (cpu >= 0) CPU_SET(cpu, &mask);
+
+	return mask;
+}
+
+/**
+ * @brief 按亲和性创建任务，访问节点0上首次写入的缓冲区，记录每遍耗时
+ *
+ * @param param : 参数名
+ * @param cpu : 绑定的CPU，小于0为不绑定
+ * @param data : 缓冲区
+ * @param words : 缓冲区长度
+ */
+void affinity_scan(const std::string &param, const int &cpu, uint64_t *data, const size_t &words)
+{
+	TaskRegisterInfo reg_info = bench_reg_info("bench scan");
+	std::vector<double> samples;
+
+	reg_info.task_attr.affinity = cpu_mask(cpu);
+
+	auto key = Task::register_task(reg_info, [&]() {
+		for (int pass = 0; pass < 50; pass++)
+		{
+			auto start = bench_clock::now();
+
+			// 每个缓存行读改写一次
+			for (size_t i = 0; i < words; i += 8) data[i]++;
+
+			samples.push_back(elapsed_ns(start));
+		}
+	});
+
+	Task::task_run(key.tid);
+	key.fut.get();
+
+	report("scan_4mb", param, "ns", samples);
+}
+
+/**
+ * @brief 两个任务交替修改同一缓存行，记录每次往返耗时
+ *
+ * @param param : 参数名
+ * @param ping : 第一个任务绑定的CPU，小于0为不绑定
+ * @param pong : 第二个任务绑定的CPU，小于0为不绑定
+ */
+void affinity_ping_pong(const std::string &param, const int &ping, const int &pong)
+{
+	const int batches = 20;
+	const int count = 1000;
+	alignas(64) std::atomic<uint64_t> ball(0);
+	TaskRegisterInfo reg_info = bench_reg_info("bench ping");
+	std::vector<double> samples;
+
+	// 等到球回到自己，自旋一段时间后让出CPU，同一CPU上的两个任务也能交替
+	auto wait_for = [&ball](const uint64_t &want) {
+		for (uint32_t spins = 1; want != ball.load(std::memory_order_acquire); spins++)
+		{
+			if (0 == (spins & 1023)) std::this_thread::yield();
+		}
+	};
+
+	reg_info.task_attr.affinity = cpu_mask(pong);
+
+	auto peer = Task::register_task(reg_info, [&]() {
+		for (uint64_t i = 0; i < static_cast<uint64_t>(batches) * count; i++)
+		{
+			wait_for(2 * i + 1);
+			ball.store(2 * i + 2, std::memory_order_release);
+		}
+	});
+
+	reg_info.task_attr.affinity = cpu_mask(ping);
+
+	auto key = Task::register_task(reg_info, [&]() {
+		uint64_t i = 0;
+
+		for (int batch = 0; batch < batches; batch++)
+		{
+			auto start = bench_clock::now();
+
+			for (int j = 0; j < count; j++, i++)
+			{
+				ball.store(2 * i + 1, std::memory_order_release);
+				wait_for(2 * i + 2);
+			}
+
+			samples.push_back(elapsed_ns(start) / count);
+		}
+	});
+
+	Task::task_run(peer.tid);
+	Task::task_run(key.tid);
+	key.fut.get();
+	peer.fut.get();
+
+	report("ping_pong", param, "ns", samples);
+}
+
+/**
+ * @brief 运行中修改CPU亲和性，以及绑定与不绑定时工作负载的耗时
+ *
+ * 缓冲区由绑定在节点0首个CPU上的任务首次写入，页分配在节点0。
+ * 有第二个NUMA节点时测试跨节点，否则只有一个节点有多个CPU时测试同节点的其他CPU。
+ */
+void bench_affinity(void)
+{
+	std::atomic<bool> started(false);
+	auto key = Task::register_task(bench_reg_info("bench affinity"), spin_alive, &started);
+	cpu_set_t affinity;
+
+	CPU_ZERO(&affinity);
+	CPU_SET(0, &affinity);
+
+	Task::task_run(key.tid);
+
+	while (!started.load(std::memory_order_acquire)) std::this_thread::yield();
+
+	report("set_affinity", "cpu0", "ns", per_call(10, 1000, [&]() { Task::set_affinity(key.tid, affinity); }));
+
+	Task::task_exit(key.tid);
+	key.fut.wait();
+	settle();
+
+	std::vector<int> local = node_cpus(0);
+	std::vector<int> remote = node_cpus(1);
+
+	// 没有NUMA信息时视为单节点
+	if (local.empty()) local.push_back(0);
+
+	const size_t words = 4 * 1024 * 1024 / sizeof(uint64_t);
+	std::unique_ptr<uint64_t[]> data(new uint64_t[words]);
+	TaskRegisterInfo reg_info = bench_reg_info("bench touch");
+
+	reg_info.task_attr.affinity = cpu_mask(local[0]);
+
+	// 节点0上首次写入
+	auto touch = Task::register_task(reg_info, [&]() { memset(data.get(), 0, words * sizeof(uint64_t)); });
+
+	Task::task_run(touch.tid);
+	touch.fut.get();
+
+	affinity_scan("pinned", local[0], data.get(), words);
+	affinity_scan("unpinned", -1, data.get(), words);
+
+	if (!remote.empty()) affinity_scan("cross_node", remote[0], data.get(), words);
+	else if (local.size() > 1) affinity_scan("other_cpu", local.back(), data.get(), words);
+
+	affinity_ping_pong("same_cpu", local[0], local[0]);
+	affinity_ping_pong("unpinned", -1, -1);
+
+	if (local.size() > 1) affinity_ping_pong("same_node", local[0], local[1]);
+	if (!remote.empty()) affinity_ping_pong("cross_node", local[0], remote[0]);
+
+	settle();
+}
+
+/**
+ * @brief 任务池吞吐
+ *
+ */
+void pool_throughput(TaskPool &pool)
+{
+	std::string param = std::to_string(pool.size()) + "threads";
+	std::vector<double> samples;
+
+	for (int round = 0; round < 5; round++)
+	{
+		const int count = 200000;
+		std::atomic<int> done(0);
+		auto start = bench_clock::now();
+
+		for (int i = 0; i < count; i++) pool.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+
+		while (count != done.load(std::memory_order_relaxed)) std::this_thread::yield();
+
+		samples.push_back(elapsed_ns(start) / count);
+	}
+
+	report("post", param, "ns", samples);
+	samples.clear();
+
+	for (int round = 0; round < 5; round++)
+	{
+		const int count = 100000;
+		std::vector<TaskFuture<int>> futures;
+		auto start = bench_clock::now();
+
+		futures.reserve(count);
+
+		for (int i = 0; i < count; i++) futures.push_back(pool.submit([i]() { return i; }));
+		for (auto &item : futures) item.get();
+
+		samples.push_back(elapsed_ns(start) / count);
+	}
+
+	report("submit_get", param, "ns", samples);
+}
+
+/**
+ * @brief post任务抛出异常后仍在工作的线程数
+ *
+ * 每个线程先收到若干抛异常的任务，再提交线程数个互相等待的任务，只有全部线程都在工作时才能同时运行
+ */
+void pool_throw_post(TaskPool &pool)
+{
+	const uint32_t threads = pool.size();
+	std::atomic<uint32_t> arrived(0);
+	std::atomic<uint32_t> done(0);
+
+	for (uint32_t i = 0; i < 4 * threads; i++) pool.post([]() { throw std::runtime_error("bench throw"); });
+
+	for (uint32_t i = 0; i < threads; i++)
+	{
+		pool.post([&]() {
+			auto deadline = bench_clock::now() + std::chrono::seconds(2);
+
+			arrived.fetch_add(1);
+
+			while (arrived.load() < threads && bench_clock::now() < deadline) std::this_thread::yield();
+
+			done.fetch_add(1);
+		});
+	}
+
+	while (done.load() < threads) std::this_thread::yield();
+
+	report("throw_post", std::to_string(threads) + "threads", "alive_workers", static_cast<double>(std::min(arrived.load(), threads)));
+}
+
+/**
+ * @brief 任务池
+ *
+ */
+void bench_pool(void)
+{
+	TaskPool pool;
+
+	pool_throughput(pool);
+
+	// 工作线程多于CPU时的提交竞争
+	{
+		TaskPool wide(32);
+
+		pool_throughput(wide);
+		pool_throw_post(wide);
+	}
+
+	pool_throw_post(pool);
+
+	TaskAttribute attr;
+
+	attr.task_name = "bench job";
+	attr.stacksize = TASK_STACKSIZE(64);
+
+	// 不同任务粒度下任务池与每次新建任务对比，每轮提交一批后等待全部完成
+	for (auto job_ns : {1000ll, 10000ll, 1000000ll})
+	{
+		const int batch = 64;
+		const int rounds = job_ns >= 1000000 ? 5 : 50;
+		std::string size = job_ns >= 1000000 ? "1ms" : std::to_string(job_ns / 1000) + "us";
+		std::vector<double> pooled;
+		std::vector<double> spawned;
+
+		for (int round = 0; round < rounds; round++)
+		{
+			std::vector<TaskFuture<void>> futures;
+			auto start = bench_clock::now();
+
+			for (int i = 0; i < batch; i++) futures.push_back(pool.submit(busy_ns, job_ns));
+			for (auto &item : futures) item.get();
+
+			pooled.push_back(elapsed_ns(start) / batch);
+
+			std::vector<TaskKey<void>> keys;
+
+			start = bench_clock::now();
+
+			for (int i = 0; i < batch; i++) keys.push_back(new_task(attr, busy_ns, job_ns));
+			for (auto &item : keys) item.fut.get();
+
+			spawned.push_back(elapsed_ns(start) / batch);
+		}
+
+		report("job_pool", size, "ns", pooled);
+		report("job_new_task", size, "ns", spawned);
+	}
+}
+
+/**
+ * @brief 返回值后续任务
+ *
+ */
+void bench_future(void)
+{
+	std::vector<double> samples;
+
+	for (int i = 0; i < 10000; i++)
+	{
+		TaskPromise<int> promise;
+		bench_clock::time_point delivered;
+		auto next = promise.get_future().then([&](TaskFuture<int>) { delivered = bench_clock::now(); });
+		auto start = bench_clock::now();
+
+		promise.set_value(i);
+		samples.push_back(std::chrono::duration<double, std::nano>(delivered - start).count());
+	}
+
+	report("then_inline", "delivery", "ns", samples);
+
+	TaskPool pool;
+	std::vector<TaskFuture<int>> futures;
+
+	samples.clear();
+
+	for (int round = 0; round < 20; round++)
+	{
+		auto start = bench_clock::now();
+
+		for (int i = 0; i < 1000; i++) futures.push_back(pool.submit([i]() { return i; }));
+
+		when_all(std::move(futures)).get();
+		futures.clear();
+		samples.push_back(elapsed_ns(start) / 1000);
+	}
+
+	report("when_all", "1000", "ns", samples);
+}
+
+/**
+ * @brief 定时服务
+ *
+ */
+void bench_timer(void)
+{
+	TaskTimer timer;
+	std::vector<uint64_t> ids;
+	const int count = 100000;
+
+	ids.reserve(count);
+
+	auto start = bench_clock::now();
+
+	for (int i = 0; i < count; i++) ids.push_back(timer.schedule_after(TASK_SEC(10) + TASK_US(i), []() {}).id);
+
+	report("insert", std::to_string(count), "ns", elapsed_ns(start) / count);
+
+	start = bench_clock::now();
+
+	for (auto &item : ids) timer.cancel(item);
+
+	report("cancel", std::to_string(count), "ns", elapsed_ns(start) / count);
+
+	// 到期延迟
+	const int fires = 2000;
+	std::vector<double> lateness(fires);
+	std::atomic<int> fired(0);
+	auto base = bench_clock::now();
+
+	for (int i = 0; i < fires; i++)
+	{
+		auto when = base + TASK_MS(1 + i % 20) + TASK_US(i % 1000);
+
+		timer.schedule_at(when, [&, i, when]() {
+			lateness[i] = std::chrono::duration<double, std::micro>(bench_clock::now() - when).count();
+			fired.fetch_add(1, std::memory_order_release);
+		});
+	}
+
+	while (fires != fired.load(std::memory_order_acquire)) std::this_thread::sleep_for(TASK_MS(1));
+
+	report("fire_lateness", "1ms_tick", "us", lateness);
+}
+
+/**
+ * @brief 依赖图调度
+ *
+ */
+void bench_graph(void)
+{
+	TaskPool pool;
+	std::vector<double> samples;
+
+	{
+		TaskGraph graph;
+		size_t source = graph.add([]() {});
+		size_t sink = graph.add([]() {});
+
+		for (int i = 0; i < 10000; i++)
+		{
+			size_t node = graph.add([]() {});
+
+			graph.precede(source, node);
+			graph.precede(node, sink);
+		}
+
+		for (int round = 0; round < 10; round++)
+		{
+			auto start = bench_clock::now();
+
+			graph.run(pool).get();
+			samples.push_back(elapsed_ns(start) / graph.size());
+		}
+
+		report("fan_out_in", "10000", "ns", samples);
+	}
+
+	samples.clear();
+
+	{
+		TaskGraph graph;
+		size_t prev = graph.add([]() {});
+
+		for (int i = 1; i < 10000; i++)
+		{
+			size_t node = graph.add([]() {});
+
+			graph.precede(prev, node);
+			prev = node;
+		}
+
+		for (int round = 0; round < 10; round++)
+		{
+			auto start = bench_clock::now();
+
+			graph.run(pool).get();
+			samples.push_back(elapsed_ns(start) / graph.size());
+		}
+
+		report("chain", "10000", "ns", samples);
+	}
+}
+
+/**
+ * @brief 多线程频繁创建结束时的吞吐和查询耗时
+ *
+ */
+void bench_churn(void)
+{
+	std::atomic<bool> started(false);
+	auto probe = Task::register_task(bench_reg_info("bench probe"), spin_alive, &started);
+
+	Task::task_run(probe.tid);
+
+	while (!started.load(std::memory_order_acquire)) std::this_thread::yield();
+
+	// 无创建时的查询
+	report("lookup", "idle", "ns", per_call(10, 10000, [&]() { Task::task_state(probe.tid); }));
+
+	// 创建线程数量从1翻倍到CPU数量的2倍，至少到4
+	unsigned max_churners = std::max(4u, 2 * std::thread::hardware_concurrency());
+
+	for (unsigned threads = 1; threads <= max_churners; threads *= 2)
+	{
+		std::string param = std::to_string(threads) + "threads";
+		std::atomic<bool> stop(false);
+		std::atomic<uint64_t> churns(0);
+		std::vector<std::thread> churners;
+
+		// 每个线程注册、启动、等待结束，覆盖发布和清理两条写路径
+		for (unsigned i = 0; i < threads; i++)
+		{
+			churners.emplace_back([&]() {
+				TaskRegisterInfo reg_info = bench_reg_info("bench churn");
+
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					auto key = Task::register_task(reg_info, []() {});
+
+					Task::task_run(key.tid);
+					key.fut.get();
+					churns.fetch_add(1, std::memory_order_relaxed);
+				}
+			});
+		}
+
+		// 固定时长内持续查询，期间让出CPU给创建线程
+		std::vector<double> samples;
+		auto start = bench_clock::now();
+
+		while (elapsed_ns(start) < 5e8)
+		{
+			auto batch = per_call(1, 1000, [&]() { Task::task_state(probe.tid); });
+
+			samples.push_back(batch.front());
+			std::this_thread::yield();
+		}
+
+		double seconds = elapsed_ns(start) / 1e9;
+
+		report("lookup", param, "ns", samples);
+		report("register_exit", param, "ops/s", churns.load(std::memory_order_relaxed) / seconds);
+
+		stop = true;
+
+		for (auto &item : churners) item.join();
+
+		settle();
+	}
+
+	Task::task_exit(probe.tid);
+	probe.fut.wait();
+	settle();
+}
+
+void print_json(void)
+{
+	printf("{\n  \"version\": \"%s\",\n  \"compiler\": \"%s\",\n  \"cpus\": %u,\n  \"timestamp\": %ld,\n  \"results\": [",
+		   get_task_version(), __VERSION__, std::thread::hardware_concurrency(), static_cast<long>(time(nullptr)));
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchResult &item = results[i];
+
+		printf("%s\n    {\"group\": \"%s\", \"name\": \"%s\", \"param\": \"%s\", \"unit\": \"%s\", \"samples\": %zu, "
+			   "\"mean\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+			   i ? "," : "", item.group.c_str(), item.name.c_str(), item.param.c_str(), item.unit.c_str(),
+			   item.samples, item.mean, item.p50, item.p99, item.max);
+	}
+
+	printf("\n  ]\n}\n");
+}
+
+void print_csv(void)
+{
+	printf("group,name,param,unit,samples,mean,p50,p99,max\n");
+
+	for (auto &item : results)
+	{
+		printf("%s,%s,%s,%s,%zu,%.3f,%.3f,%.3f,%.3f\n", item.group.c_str(), item.name.c_str(), item.param.c_str(),
+			   item.unit.c_str(), item.samples, item.mean, item.p50, item.p99, item.max);
+	}
+}
+
+// 执行fn期间当前线程的堆分配次数
+template <typename F>
+double count_allocs(F &&fn)
+{
+	uint64_t before = allocs;
+
+	fn();
+
+	return static_cast<double>(allocs - before);
+}
+
+/**
+ * @brief 任务调用的堆分配次数
+ *
+ * 只统计调用线程，先预热使描述符池、线程缓存和队列达到稳定状态
+ */
+void bench_alloc(void)
+{
+	const int warmup = 100;
+	const int count = 1000;
+	void *a = nullptr;
+	void *b = nullptr;
+	void *c = nullptr;
+	std::vector<double> samples;
+
+	// 捕获少量数据的可调用对象放在内联缓冲区
+	for (int i = 0; i < count; i++)
+	{
+		samples.push_back(count_allocs([&]() {
+			TaskFunction<void()> fn([a, b, c]() { (void)a; (void)b; (void)c; });
+			TaskFunction<void()> moved(std::move(fn));
+
+			moved();
+		}));
+	}
+
+	report("task_function", "small", "allocs", samples);
+
+	/**
+	 * @brief 超出内联缓冲区的捕获
+	 *
+	 */
+	struct Large
+	{
+		char data[256];
+	} large{};
+
+	samples.clear();
+
+	for (int i = 0; i < count; i++)
+	{
+		samples.push_back(count_allocs([&]() {
+			TaskFunction<void()> fn([large]() { (void)large; });
+			TaskFunction<void()> moved(std::move(fn));
+
+			moved();
+		}));
+	}
+
+	report("task_function", "large", "allocs", samples);
+
+	TaskRegisterInfo reg_info = bench_reg_info("bench alloc");
+	TaskAttribute attr = reg_info.task_attr;
+	std::vector<double> registers;
+	std::vector<double> stop_registers;
+	std::vector<double> hooks;
+	std::vector<double> spawns;
+
+	for (int i = 0; i < warmup + count; i++)
+	{
+		TaskKey<void> key;
+
+		// 接收停止令牌的任务另有一次停止状态分配
+		double stop_registered = count_allocs([&]() { key = Task::register_task(reg_info, [a](TaskStopToken) { (void)a; }); });
+
+		Task::task_run(key.tid);
+		key.fut.get();
+		Task::task_exit(key.tid);
+
+		// 任务调用和返回值共用一次分配，不接收令牌时不申请停止状态
+		double registered = count_allocs([&]() { key = Task::register_task(reg_info, [a]() { (void)a; }); });
+		// 三个异常、超时、结束行为，各自返回的future需要比描述符活得久，每个一次分配
+		double hooked = count_allocs([&]() {
+			Task::add_task_except_action(key.tid, [a]() { (void)a; });
+			Task::add_task_timeout_action(key.tid, [a]() { (void)a; });
+			Task::add_task_exit_action(key.tid, [a]() { (void)a; });
+		});
+
+		Task::task_run(key.tid);
+		key.fut.get();
+		Task::task_exit(key.tid);
+
+		double spawned = count_allocs([&]() { key = new_task(attr, [a]() { (void)a; }); });
+
+		key.fut.get();
+
+		if (i < warmup) continue;
+
+		registers.push_back(registered);
+		stop_registers.push_back(stop_registered);
+		hooks.push_back(hooked);
+		spawns.push_back(spawned);
+	}
+
+	report("register_task", "small", "allocs", registers);
+	report("register_task", "stop_token", "allocs", stop_registers);
+	report("task_actions", "3", "allocs", hooks);
+	report("new_task", "small", "allocs", spawns);
+
+	TaskPool pool;
+	std::vector<double> posts;
+	std::vector<double> submits;
+
+	for (int i = 0; i < warmup + count; i++)
+	{
+		double posted = count_allocs([&]() { pool.post([a]() { (void)a; }); });
+		TaskFuture<int> fut;
+		double submitted = count_allocs([&]() { fut = pool.submit([i]() { return i; }); });
+
+		fut.get();
+
+		if (i < warmup) continue;
+
+		posts.push_back(posted);
+		submits.push_back(submitted);
+	}
+
+	report("pool_post", "small", "allocs", posts);
+	report("pool_submit", "small", "allocs", submits);
+
+	settle();
+}
+
+// 计数并分配，operator new的各重载都经过这里
+// [NOTE]:分配与释放放在不内联的函数里，编译器不会把内联后的free与operator new配对误报-Wmismatched-new-delete
+[[gnu::noinline]] void *counted_alloc(size_t size, size_t alignment)
+{
+	allocs++;
+
+	size = size ? size : 1;
+
+	void *p = alignment > alignof(std::max_align_t)
+				  ? aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+				  : malloc(size);
+
+	if (!p) throw std::bad_alloc();
+
+	return p;
+}
+
+// 释放counted_alloc分配的内存
+[[gnu::noinline]] void counted_free(void *p) noexcept
+{
+	free(p);
+}
+
+} // namespace
+
+// 替换全局operator new/delete，统计当前线程的分配次数，数组形式默认转调这些重载
+void *operator new(size_t size) { return counted_alloc(size, 0); }
+void *operator new(size_t size, std::align_val_t align) { return counted_alloc(size, static_cast<size_t>(align)); }
+
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete(void *p, size_t) noexcept { counted_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept { counted_free(p); }
+
+int main(int argc, char **argv)
+{
+	bool csv = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "--csv"))
+		{
+			csv = true;
+		}
+		else
+		{
+			groups.push_back(argv[i]);
+		}
+	}
+
+	Task::task_init(BENCH_MAX_TASKS, nullptr, BENCH_MANAGE_PERIOD);
+
+	if (enabled("spawn")) bench_spawn();
+	if (enabled("table")) bench_table();
+	if (enabled("exit")) bench_exit();
+	if (enabled("wake")) bench_wake();
+	if (enabled("affinity")) bench_affinity();
+	if (enabled("pool")) bench_pool();
+	if (enabled("future")) bench_future();
+	if (enabled("timer")) bench_timer();
+	if (enabled("graph")) bench_graph();
+	if (enabled("churn")) bench_churn();
+	if (enabled("alloc")) bench_alloc();
+
+	Task::task_exit_all();
+
+	csv ? print_csv() : print_json();
+
+	return 0;
+}
@@ -47,15 +47,16 @@ int main(void)
 	reg_info.task_attr.task_name = "test task1";
 	reg_info.task_attr.stacksize = TASK_STACKSIZE(50);
 	reg_info.task_attr.priority = e_sys_task_pri_lv;
-	reg_info.alive_time = 3 * 60;
+	reg_info.alive_time = TASK_SEC(3 * 60);
 	reg_info.e_action = e_task_default;
 
 	auto ret = Task::register_task(reg_info, [&](int a, int b) -> int {
-		for (int i = 6; Task::is_task_alive(task_id()) && i; i--)
+		// 当前任务查询不查表
+		for (int i = 6; Task::self().alive() && i; i--)
 		{
-			std::cout << "alive1....... " << task_id() << std::endl;
-			std::cout << "name : " << get_task_name() << std::endl;
-			assert(Task::task_state(task_id()) == wotsen::e_task_alive);
+			std::cout << "alive1....... " << Task::self().tid() << std::endl;
+			std::cout << "name : " << Task::self().name() << std::endl;
+			assert(Task::self().state() == wotsen::e_task_alive);
 			std::this_thread::sleep_for(std::chrono::seconds(1));
 		}
 
@@ -79,13 +80,14 @@ int main(void)
 
 	/*************************************任务2********************************************/
 	reg_info.task_attr.task_name = "test task2";
-	reg_info.alive_time = 90;
+	reg_info.alive_time = TASK_SEC(90);
 
-	auto ret2 = Task::register_task(reg_info, [](int a, int b) -> int {
-		for (int i = 3; Task::is_task_alive(task_id()) && i; i--)
+	// 第一个参数为停止令牌，task_exit时睡眠立即返回
+	auto ret2 = Task::register_task(reg_info, [](TaskStopToken stop, int a, int b) -> int {
+		for (int i = 3; !stop.stop_requested() && i; i--)
 		{
 			std::cout << "alive2....... " << task_id() << std::endl;
-			std::this_thread::sleep_for(std::chrono::seconds(1));
+			stop.sleep_for(std::chrono::seconds(1));
 		}
 
 		return 200;
@@ -107,7 +109,7 @@ int main(void)
 	reg_info1.task_attr.task_name = "test task3";
 	reg_info1.task_attr.stacksize = TASK_STACKSIZE(50);
 	reg_info1.task_attr.priority = e_sys_task_pri_lv;
-	reg_info1.alive_time = 1;
+	reg_info1.alive_time = TASK_SEC(1);
 	reg_info1.e_action = e_task_default;
 
 	auto ret3 = Task::register_task(reg_info1, [](int a, int b) -> int {
@@ -146,9 +148,16 @@ int main(void)
 	},
 						 10, 20);
 
-	std::cout << "task2 ret" << ret2.fut.get() << std::endl;
-	std::cout << "task3 ret" << ret3.fut.get() << std::endl;
-	std::cout << "task4 ret" << retn.fut.get() << std::endl;
+	// 全部结束后在最后结束的任务线程上输出，主线程只等待一次
+	auto all = when_all(std::move(ret2.fut), std::move(ret3.fut), std::move(retn.fut)).then([](auto rets) {
+		auto results = rets.get();
+
+		std::cout << "task2 ret" << std::get<0>(results).get() << std::endl;
+		std::cout << "task3 ret" << std::get<1>(results).get() << std::endl;
+		std::cout << "task4 ret" << std::get<2>(results).get() << std::endl;
+	});
+
+	all.wait();
 
 	// 继续
 	Task::task_continue(ret.tid);
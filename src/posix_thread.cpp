@@ -8,11 +8,22 @@
  * @copyright Copyright (c) 2020
  * 
  */
+#include <ctime>
 #include <cstring>
 #include <cerrno>
 #include <csignal>
 #include <pthread.h>
+#include <unistd.h>
 #include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+#include <condition_variable>
 #include "posix_thread.h"
 
 namespace wotsen
@@ -29,102 +40,796 @@ enum
 #endif
 
 /**
- * @brief 创建线程
+ * @brief 线程缓存键，属性相同的线程才能复用
  * 
- * @param tid 线程id
- * @param stacksize 线程栈大小
- * @param priority 线程优先级
- * @param fn 线程人物接口
- * @param arg 传递给线程的参数
- * @return true 创建成功
- * @return false 创建失败
  */
-bool create_thread(uint64_t *tid, const size_t &stacksize,
-					const int &priority, thread_func fn, void *arg)
+struct thread_cache_key
 {
-	pthread_t _tid = INVALID_PTHREAD_TID;
-	pthread_attr_t attr;
-	struct sched_param param;
-	int min_pri = sched_get_priority_min(SCHED_RR);
-	int max_pri = sched_get_priority_max(SCHED_RR);
-	size_t _stacksize = stacksize;
-	int _pri = priority;
+	struct thread_attr attr;	///< 矫正后的线程属性
 
-	memset(&attr, 0, sizeof(attr));
-	memset(&param, 0, sizeof(param));
+	bool operator<(const thread_cache_key &other) const noexcept
+	{
+		auto l = std::tie(attr.stacksize, attr.policy, attr.priority, attr.nice, attr.numa_node,
+						  attr.dl_runtime, attr.dl_deadline, attr.dl_period);
+		auto r = std::tie(other.attr.stacksize, other.attr.policy, other.attr.priority, other.attr.nice, other.attr.numa_node,
+						  other.attr.dl_runtime, other.attr.dl_deadline, other.attr.dl_period);
 
-	/* 矫正线程栈 */
-	_stacksize = _stacksize < PTHREAD_STACK_MIN ? PTHREAD_STACK_MIN : _stacksize;
+		if (l != r) return l < r;
 
-	/* 矫正优先级 */
-	if (min_pri > _pri)
-	{
-		_pri = min_pri;
+		return memcmp(&attr.affinity, &other.attr.affinity, sizeof(attr.affinity)) < 0;
 	}
-	else if (max_pri < _pri)
+};
+
+/**
+ * @brief 缓存线程
+ * 
+ */
+struct thread_cache_item
+{
+	uint64_t tid;						///< pthread_t
+	uint16_t gen;						///< 运行代数，每分配一次任务加1，不为0
+	thread_cache_key key;				///< 线程属性
+	thread_func fn;						///< 当前任务接口
+	void *arg;							///< 当前任务参数
+	bool running;						///< 正在执行任务
+	bool dirty;							///< 运行期间修改过线程属性，不再缓存
+	int policy;							///< 实际调度策略
+	std::condition_variable cond;		///< 分配任务唤醒
+	thread_cache_item *prev;			///< 空闲链表前一项
+	thread_cache_item *next;			///< 空闲链表后一项
+	thread_cache_item **head;			///< 所在空闲链表头，nullptr为不在链表中
+};
+
+/**
+ * @brief 线程缓存
+ * 
+ * 任务结束后线程不退出，按线程属性(栈大小, 调度策略, 优先级, 亲和性, NUMA节点)挂到空闲链表上，下次创建相同属性的线程时直接唤醒复用，
+ * 省去线程创建和栈的mmap/munmap。空闲超时或超出上限的线程退出。
+ * 每次分配任务运行代数加1，对外的线程号带运行代数，线程复用后旧线程号不会命中新任务。
+ * 
+ * [NOTE]:复用的线程不会析构thread_local变量和线程私有数据，取消状态在每次任务开始前恢复默认，
+ * 任务自行修改的调度策略不会恢复
+ */
+struct thread_cache
+{
+	std::mutex mtx;												///< 缓存锁
+	std::map<thread_cache_key, thread_cache_item *> idle_list;	///< 各属性空闲线程，后进先出
+	std::unordered_map<uint64_t, thread_cache_item *> threads;	///< 所有缓存管理的线程
+	uint32_t idle;												///< 空闲线程数
+	uint32_t max_idle;											///< 空闲线程上限
+	std::chrono::milliseconds idle_timeout;						///< 空闲超时
+	uint64_t hits;												///< 复用次数
+	uint64_t misses;											///< 新建次数
+	uint64_t expired;											///< 空闲退出数
+
+	thread_cache() : idle(0), max_idle(THREAD_CACHE_MAX_IDLE),
+					 idle_timeout(THREAD_CACHE_IDLE_TIMEOUT),
+					 hits(0), misses(0), expired(0) {}
+};
+
+///< 线程号高16位为运行代数，低48位为pthread_t(用户空间地址不超过48位)
+#define THREAD_GEN_SHIFT 48
+
+static_assert(sizeof(pthread_t) == sizeof(uint64_t), "pthread_t is not 64 bits");
+
+///< 缓存线程当前运行的线程号，其他线程为INVALID_PTHREAD_TID
+static thread_local uint64_t tls_tid = INVALID_PTHREAD_TID;
+
+// 线程号中的pthread_t
+static inline pthread_t thread_handle(const uint64_t &tid)
+{
+	return static_cast<pthread_t>(tid & ((1ull << THREAD_GEN_SHIFT) - 1));
+}
+
+// 线程号中的运行代数，非缓存线程为0
+static inline uint16_t thread_gen(const uint64_t &tid)
+{
+	return static_cast<uint16_t>(tid >> THREAD_GEN_SHIFT);
+}
+
+// 缓存线程本次运行的线程号，复用后旧线程号的代数不再匹配
+static inline uint64_t thread_run_id(const thread_cache_item *item)
+{
+	return item->tid | static_cast<uint64_t>(item->gen) << THREAD_GEN_SHIFT;
+}
+
+// 进入下一次运行，需持有锁
+static inline void thread_next_gen(thread_cache_item *item)
+{
+	if (0 == ++item->gen) item->gen = 1;
+}
+
+static thread_cache &get_thread_cache(void)
+{
+	// 缓存线程是分离的，进程退出时可能仍在使用，不析构
+	static thread_cache *cache = new thread_cache;
+
+	return *cache;
+}
+
+// 放入空闲链表，需持有锁
+static void thread_idle_push(thread_cache &cache, thread_cache_item *item)
+{
+	thread_cache_item *&head = cache.idle_list[item->key];
+
+	item->prev = nullptr;
+	item->next = head;
+	item->head = &head;
+
+	if (head) head->prev = item;
+
+	head = item;
+	cache.idle++;
+}
+
+// 移出空闲链表，需持有锁
+static void thread_idle_remove(thread_cache &cache, thread_cache_item *item)
+{
+	if (item->prev)
 	{
-		_pri = max_pri;
+		item->prev->next = item->next;
 	}
 	else
 	{
-		// PASS
+		*item->head = item->next;
 	}
 
-	param.sched_priority = _pri;
+	if (item->next) item->next->prev = item->prev;
+
+	item->prev = nullptr;
+	item->next = nullptr;
+	item->head = nullptr;
+	cache.idle--;
+}
+
+/**
+ * @brief 读取NUMA节点的CPU
+ * 
+ * @param node NUMA节点
+ * @param cpus 节点的CPU
+ * @return true 读取成功
+ * @return false 节点不存在
+ */
+static bool numa_node_cpus(const int &node, cpu_set_t &cpus)
+{
+	char path[64] = {'\0'};
+	unsigned int first = 0;
+	unsigned int last = 0;
+	int c = 0;
 
-	if (pthread_attr_init(&attr) < 0)
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+
+	FILE *fp = fopen(path, "r");
+
+	if (!fp)
 	{
 		return false;
 	}
 
-	/* 设置线程分离 */
-	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) < 0)
+	CPU_ZERO(&cpus);
+
+	/* 格式如0-3,8-11 */
+	while (fscanf(fp, "%u", &first) == 1)
+	{
+		last = first;
+		c = fgetc(fp);
+
+		if ('-' == c)
+		{
+			if (fscanf(fp, "%u", &last) != 1) break;
+
+			c = fgetc(fp);
+		}
+
+		for (unsigned int i = first; i <= last && i < CPU_SETSIZE; i++)
+		{
+			CPU_SET(i, &cpus);
+		}
+
+		if (',' != c) break;
+	}
+
+	fclose(fp);
+
+	return CPU_COUNT(&cpus) > 0;
+}
+
+/**
+ * @brief 本线程的栈优先从NUMA节点分配，已分配的页迁移到该节点
+ * 
+ * @param node NUMA节点
+ */
+static void thread_bind_stack(const int &node)
+{
+	pthread_attr_t attr;
+	void *addr = nullptr;
+	size_t size = 0;
+	unsigned long nodemask = 0;
+
+	if (node < 0 || node >= (int)(sizeof(nodemask) * 8))
+	{
+		return;
+	}
+
+	if (pthread_getattr_np(pthread_self(), &attr) != 0)
+	{
+		return;
+	}
+
+	nodemask = 1ul << node;
+
+	// 不依赖libnuma，失败时保持默认的首次访问分配
+	if (pthread_attr_getstack(&attr, &addr, &size) == 0)
+	{
+		syscall(SYS_mbind, addr, size, MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8 + 1, MPOL_MF_MOVE);
+	}
+
+	pthread_attr_destroy(&attr);
+}
+
+///< 调度策略未确定
+#define THREAD_SCHED_PENDING -2
+
+/**
+ * @brief sched_setattr参数，与内核定义一致
+ * 
+ */
+struct thread_sched_attr
+{
+	uint32_t size;
+	uint32_t sched_policy;
+	uint64_t sched_flags;
+	int32_t sched_nice;
+	uint32_t sched_priority;
+	uint64_t sched_runtime;
+	uint64_t sched_deadline;
+	uint64_t sched_period;
+};
+
+// 本线程实际调度策略
+static int thread_sched_policy(void)
+{
+	// 去掉SCHED_RESET_ON_FORK等标记
+	return sched_getscheduler(0) & ~SCHED_RESET_ON_FORK;
+}
+
+// pthread属性只支持SCHED_OTHER/SCHED_FIFO/SCHED_RR，其他策略由线程自己设置
+static inline bool thread_sched_by_attr(const int &policy)
+{
+	return SCHED_OTHER == policy || SCHED_FIFO == policy || SCHED_RR == policy;
+}
+
+/**
+ * @brief 新线程设置pthread属性不支持的调度参数
+ * 
+ * SCHED_BATCH/SCHED_IDLE/SCHED_DEADLINE由线程自己通过sched_setattr设置，设置结果通知创建者；
+ * nice值是线程级的，也在线程内设置，失败时保持继承值。
+ * 
+ * @param item 缓存线程
+ */
+static void thread_setup_sched(thread_cache_item *item)
+{
+	const struct thread_attr &attr = item->key.attr;
+	id_t tid = static_cast<id_t>(syscall(SYS_gettid));
+
+	if (THREAD_SCHED_INHERIT != attr.policy && !thread_sched_by_attr(attr.policy))
+	{
+		struct thread_sched_attr sched_attr;
+
+		memset(&sched_attr, 0, sizeof(sched_attr));
+
+		sched_attr.size = sizeof(sched_attr);
+		sched_attr.sched_policy = attr.policy;
+		sched_attr.sched_nice = attr.nice ? attr.nice : getpriority(PRIO_PROCESS, tid);
+		sched_attr.sched_runtime = attr.dl_runtime;
+		sched_attr.sched_deadline = attr.dl_deadline ? attr.dl_deadline : attr.dl_period;
+		sched_attr.sched_period = attr.dl_period;
+
+		// 没有权限或带宽不足时保持继承的调度策略
+		syscall(SYS_sched_setattr, 0, &sched_attr, 0);
+
+		thread_cache &cache = get_thread_cache();
+		std::unique_lock<std::mutex> lock(cache.mtx);
+
+		item->policy = thread_sched_policy();
+		item->cond.notify_one();
+	}
+	else if (0 != attr.nice)
+	{
+		setpriority(PRIO_PROCESS, tid, attr.nice);
+	}
+}
+
+/**
+ * @brief 任务结束后等待复用
+ * 
+ * @param item 缓存线程
+ * @return true 分配到新任务
+ * @return false 线程退出
+ */
+static bool thread_park(thread_cache_item *item)
+{
+	thread_cache &cache = get_thread_cache();
+
+	{
+		std::unique_lock<std::mutex> lock(cache.mtx);
+
+		// 之后release_thread不再取消本线程
+		item->running = false;
+	}
+
+	// 恢复默认取消属性，执行任务期间收到的取消请求在这里生效
+	pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
+	pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, nullptr);
+	pthread_testcancel();
+
+	// 空闲期间不属于任何任务，不响应取消
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, nullptr);
+
+	std::unique_lock<std::mutex> lock(cache.mtx);
+
+	if (item->dirty || cache.idle >= cache.max_idle) return false;
+
+	thread_idle_push(cache, item);
+
+	auto deadline = std::chrono::steady_clock::now() + cache.idle_timeout;
+
+	while (!item->running)
+	{
+		// 超时或上限调小
+		if (cache.idle > cache.max_idle
+			|| (std::cv_status::timeout == item->cond.wait_until(lock, deadline) && !item->running))
+		{
+			thread_idle_remove(cache, item);
+			cache.expired++;
+
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// 缓存线程入口
+static void *thread_cache_run(void *arg)
+{
+	/**
+	 * @brief 线程退出或被取消时注销
+	 * 
+	 */
+	struct thread_cache_guard
+	{
+		thread_cache_item *item;
+
+		~thread_cache_guard()
+		{
+			thread_cache &cache = get_thread_cache();
+
+			{
+				std::unique_lock<std::mutex> lock(cache.mtx);
+				cache.threads.erase(item->tid);
+			}
+
+			delete item;
+		}
+	} guard{static_cast<thread_cache_item *>(arg)};
+
+	thread_cache_item *item = guard.item;
+
+	{
+		thread_cache &cache = get_thread_cache();
+		std::unique_lock<std::mutex> lock(cache.mtx);
+
+		// 创建者在锁外创建线程，注册后才能执行任务或注销
+		while (INVALID_PTHREAD_TID == item->tid) item->cond.wait(lock);
+	}
+
+	thread_setup_sched(item);
+
+	if (THREAD_NUMA_NODE_ANY != item->key.attr.numa_node) thread_bind_stack(item->key.attr.numa_node);
+
+	do
+	{
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, nullptr);
+		pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, nullptr);
+
+		// 分配任务时已在锁内更新代数
+		tls_tid = thread_run_id(item);
+
+		item->fn(item->arg);
+	} while (thread_park(item));
+
+	return (void *)0;
+}
+
+/**
+ * @brief 按缓存键创建系统线程，不持有锁
+ * 
+ * @param item 缓存线程，线程注册前不访问缓存
+ * @param _tid 新线程
+ * @return true 创建成功
+ * @return false 创建失败
+ */
+static bool thread_start(thread_cache_item *item, pthread_t &_tid)
+{
+	pthread_attr_t attr;
+	struct sched_param param;
+	struct thread_attr &_attr = item->key.attr;
+	cpu_set_t cpus = _attr.affinity;
+	bool explicit_sched = thread_sched_by_attr(_attr.policy);
+	int ret = 0;
+
+	memset(&attr, 0, sizeof(attr));
+	memset(&param, 0, sizeof(param));
+
+	param.sched_priority = _attr.priority;
+
+	if (pthread_attr_init(&attr) != 0)
 	{
-		pthread_attr_destroy(&attr);
 		return false;
 	}
 
-	/* 设置调度策略FIFO */
-	if (pthread_attr_setschedpolicy(&attr, SCHED_RR) < 0)
+	/* 设置线程分离 */
+	if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0)
 	{
 		pthread_attr_destroy(&attr);
-        return false;
+		return false;
 	}
 
-	/* 设置线程优先级 */
-	if (pthread_attr_setschedparam(&attr, &param) < 0)
+	/* 设置调度策略，默认继承创建者，不显式设置时pthread会忽略策略和优先级 */
+	if (explicit_sched
+		&& (pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) != 0
+			|| pthread_attr_setschedpolicy(&attr, _attr.policy) != 0
+			|| pthread_attr_setschedparam(&attr, &param) != 0))
 	{
 		pthread_attr_destroy(&attr);
         return false;
 	}
 
 	/* 设置线程栈大小 */
-	if (pthread_attr_setstacksize(&attr, stacksize) < 0)
+	if (pthread_attr_setstacksize(&attr, _attr.stacksize) != 0)
     {
 		pthread_attr_destroy(&attr);
         return false;
     }
 
-	/* 创建线程 */
-	if (pthread_create(&_tid, &attr, fn, arg) < 0)
+	/* 未指定亲和性时绑定到NUMA节点的CPU */
+	if (0 == CPU_COUNT(&cpus) && THREAD_NUMA_NODE_ANY != _attr.numa_node)
+	{
+		numa_node_cpus(_attr.numa_node, cpus);
+	}
+
+	/* 设置CPU亲和性 */
+	if (CPU_COUNT(&cpus) > 0 && pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus) != 0)
 	{
 		pthread_attr_destroy(&attr);
 		return false;
 	}
 
-	if (tid)
+	item->policy = explicit_sched ? _attr.policy : THREAD_SCHED_PENDING;
+
+	/* 创建线程，线程先等待注册，不会在注册前注销 */
+	ret = pthread_create(&_tid, &attr, thread_cache_run, item);
+
+	/* 没有实时调度权限，降级为SCHED_OTHER */
+	if (EPERM == ret && explicit_sched && SCHED_OTHER != _attr.policy)
 	{
-		*tid = static_cast<uint64_t>(_tid);
+		param.sched_priority = 0;
+		item->policy = SCHED_OTHER;
+
+		pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+		pthread_attr_setschedparam(&attr, &param);
+
+		ret = pthread_create(&_tid, &attr, thread_cache_run, item);
 	}
 
 	pthread_attr_destroy(&attr);
 
+	return 0 == ret;
+}
+
+/**
+ * @brief 新建缓存线程，需持有锁，创建期间释放锁
+ * 
+ * @param lock 缓存锁
+ * @param item 缓存线程
+ * @return true 创建成功
+ * @return false 创建失败
+ */
+static bool thread_spawn(std::unique_lock<std::mutex> &lock, thread_cache_item *item)
+{
+	pthread_t _tid = INVALID_PTHREAD_TID;
+	thread_cache &cache = get_thread_cache();
+	const struct thread_attr &_attr = item->key.attr;
+	bool explicit_sched = thread_sched_by_attr(_attr.policy);
+
+	// pthread_create可能要mmap栈，锁外创建，其他线程的创建和复用不被阻塞
+	lock.unlock();
+
+	bool ret = thread_start(item, _tid);
+
+	lock.lock();
+
+	if (!ret)
+	{
+		return false;
+	}
+
+	// 注册后唤醒新线程
+	item->tid = static_cast<uint64_t>(_tid);
+	item->gen = 1;
+	cache.threads[item->tid] = item;
+	item->cond.notify_one();
+
+	if (THREAD_SCHED_INHERIT == _attr.policy)
+	{
+		// 继承创建者
+		item->policy = thread_sched_policy();
+	}
+	else if (!explicit_sched)
+	{
+		// 等待线程设置结果
+		while (THREAD_SCHED_PENDING == item->policy) item->cond.wait(lock);
+	}
+
 	return true;
 }
 
+/**
+ * @brief 创建线程
+ * 
+ * @param tid 线程id
+ * @param stacksize 线程栈大小
+ * @param priority 线程优先级
+ * @param fn 线程人物接口
+ * @param arg 传递给线程的参数
+ * @return true 创建成功
+ * @return false 创建失败
+ */
+bool create_thread(uint64_t *tid, const size_t &stacksize,
+					const int &priority, thread_func fn, void *arg)
+{
+	struct thread_attr attr;
+
+	attr.stacksize = stacksize;
+	attr.priority = priority;
+	attr.numa_node = THREAD_NUMA_NODE_ANY;
+	attr.policy = THREAD_SCHED_INHERIT;
+	attr.nice = 0;
+	attr.dl_runtime = 0;
+	attr.dl_deadline = 0;
+	attr.dl_period = 0;
+	CPU_ZERO(&attr.affinity);
+
+	return create_thread(tid, attr, fn, arg);
+}
+
+/**
+ * @brief 创建线程，优先复用属性相同的空闲线程
+ * 
+ * @param tid 线程id
+ * @param attr 线程属性
+ * @param fn 线程人物接口
+ * @param arg 传递给线程的参数
+ * @param policy 实际使用的调度策略
+ * @return true 创建成功
+ * @return false 创建失败
+ */
+bool create_thread(uint64_t *tid, const struct thread_attr &attr, thread_func fn, void *arg, int *policy)
+{
+	thread_cache_key key = {attr};
+	thread_cache &cache = get_thread_cache();
+
+	/* 矫正线程栈 */
+	key.attr.stacksize = key.attr.stacksize < PTHREAD_STACK_MIN ? PTHREAD_STACK_MIN : key.attr.stacksize;
+
+	/* 矫正优先级，只有实时策略使用优先级 */
+	if (SCHED_FIFO == key.attr.policy || SCHED_RR == key.attr.policy)
+	{
+		int min_pri = sched_get_priority_min(key.attr.policy);
+		int max_pri = sched_get_priority_max(key.attr.policy);
+
+		if (min_pri > key.attr.priority)
+		{
+			key.attr.priority = min_pri;
+		}
+		else if (max_pri < key.attr.priority)
+		{
+			key.attr.priority = max_pri;
+		}
+		else
+		{
+			// PASS
+		}
+	}
+	else
+	{
+		key.attr.priority = 0;
+	}
+
+	/* 只有SCHED_DEADLINE使用带宽参数 */
+	if (SCHED_DEADLINE != key.attr.policy)
+	{
+		key.attr.dl_runtime = 0;
+		key.attr.dl_deadline = 0;
+		key.attr.dl_period = 0;
+	}
+
+	/* 矫正NUMA节点 */
+	if (key.attr.numa_node < 0)
+	{
+		key.attr.numa_node = THREAD_NUMA_NODE_ANY;
+	}
+
+	std::unique_lock<std::mutex> lock(cache.mtx);
+
+	auto it = cache.idle_list.find(key);
+	thread_cache_item *item = nullptr;
+
+	if (it != cache.idle_list.end() && it->second)
+	{
+		// 复用空闲线程
+		item = it->second;
+
+		thread_idle_remove(cache, item);
+
+		item->fn = fn;
+		item->arg = arg;
+		item->running = true;
+		thread_next_gen(item);
+		item->cond.notify_one();
+
+		cache.hits++;
+	}
+	else
+	{
+		item = new thread_cache_item;
+
+		item->tid = INVALID_PTHREAD_TID;
+		item->gen = 0;
+		item->key = key;
+		item->fn = fn;
+		item->arg = arg;
+		item->running = true;
+		item->dirty = false;
+		item->policy = THREAD_SCHED_INHERIT;
+		item->prev = nullptr;
+		item->next = nullptr;
+		item->head = nullptr;
+
+		if (!thread_spawn(lock, item))
+		{
+			delete item;
+			return false;
+		}
+
+		cache.misses++;
+	}
+
+	if (tid)
+	{
+		*tid = thread_run_id(item);
+	}
+
+	if (policy)
+	{
+		*policy = item->policy;
+	}
+
+	return true;
+}
+
+/**
+ * @brief 设置线程缓存
+ * 
+ * @param max_idle 空闲线程上限，为0时不缓存
+ * @param idle_timeout_ms 空闲超时，毫秒
+ */
+void set_thread_cache(const uint32_t &max_idle, const uint32_t &idle_timeout_ms)
+{
+	thread_cache &cache = get_thread_cache();
+	std::unique_lock<std::mutex> lock(cache.mtx);
+
+	cache.max_idle = max_idle;
+	cache.idle_timeout = std::chrono::milliseconds(idle_timeout_ms);
+
+	// 超出上限的空闲线程退出
+	for (auto &item : cache.idle_list)
+	{
+		for (thread_cache_item *i = item.second; i; i = i->next) i->cond.notify_one();
+	}
+}
+
+/**
+ * @brief 获取线程缓存统计
+ * 
+ * @return struct thread_cache_stat 统计
+ */
+struct thread_cache_stat get_thread_cache_stat(void)
+{
+	thread_cache &cache = get_thread_cache();
+	std::unique_lock<std::mutex> lock(cache.mtx);
+
+	return {cache.hits, cache.misses, cache.expired, cache.idle};
+}
+
 uint64_t thread_id(void)
 {
-	return static_cast<uint64_t>(pthread_self());
+	// 缓存线程返回带运行代数的线程号
+	return INVALID_PTHREAD_TID != tls_tid ? tls_tid : static_cast<uint64_t>(pthread_self());
+}
+
+int thread_kernel_id(void)
+{
+	return static_cast<int>(syscall(SYS_gettid));
+}
+
+/**
+ * @brief 获取线程CPU时间
+ * 
+ * @param tid 线程号，线程必须存活
+ * @param ns CPU时间，纳秒
+ * @return true 获取成功
+ * @return false 获取失败
+ */
+bool thread_cpu_time(const uint64_t &tid, uint64_t &ns)
+{
+	clockid_t cid;
+	struct timespec ts;
+
+	if (pthread_getcpuclockid(thread_handle(tid), &cid) != 0 || clock_gettime(cid, &ts) != 0)
+	{
+		return false;
+	}
+
+	ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+
+	return true;
+}
+
+/**
+ * @brief 获取线程上下文切换次数
+ * 
+ * @param ktid 内核线程号
+ * @param voluntary 主动切换次数
+ * @param involuntary 被动切换次数
+ * @return true 获取成功
+ * @return false 线程不存在
+ */
+bool thread_ctx_switches(const int &ktid, uint64_t &voluntary, uint64_t &involuntary)
+{
+	char path[64] = {'\0'};
+	char line[128] = {'\0'};
+	int found = 0;
+
+	snprintf(path, sizeof(path), "/proc/self/task/%d/status", ktid);
+
+	FILE *fp = fopen(path, "r");
+
+	if (!fp)
+	{
+		return false;
+	}
+
+	while (found < 2 && fgets(line, sizeof(line), fp))
+	{
+		unsigned long long value = 0;
+
+		if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1)
+		{
+			voluntary = value;
+			found++;
+		}
+		else if (sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1)
+		{
+			involuntary = value;
+			found++;
+		}
+	}
+
+	fclose(fp);
+
+	return 2 == found;
 }
 
 /**
@@ -135,7 +840,7 @@ uint64_t thread_id(void)
 void set_thread_name(const char *name, const uint64_t &tid)
 {
 	char pname[MAX_THREAD_NAME_LEN + 1] = {'\0'};
-	pthread_t _tid = tid != INVALID_PTHREAD_TID ? tid : pthread_self();
+	pthread_t _tid = tid != INVALID_PTHREAD_TID ? thread_handle(tid) : pthread_self();
 
 	if (name)
     {
@@ -152,14 +857,14 @@ void set_thread_name(const char *name, const uint64_t &tid)
 }
 
 ///< 获取线程名
-std::string &&get_thread_name(const uint64_t &tid)
+std::string get_thread_name(const uint64_t &tid)
 {
 	char pname[MAX_THREAD_NAME_LEN + 1] = {'\0'};
-	pthread_t _tid = tid != INVALID_PTHREAD_TID ? tid : pthread_self();
+	pthread_t _tid = tid != INVALID_PTHREAD_TID ? thread_handle(tid) : pthread_self();
 
 	pthread_getname_np(_tid, pname, sizeof(pname));
 
-	return std::move(std::string(pname));
+	return std::string(pname);
 }
 
 /**
@@ -171,9 +876,22 @@ std::string &&get_thread_name(const uint64_t &tid)
  */
 bool release_thread(const uint64_t &tid)
 {
+	pthread_t _tid = thread_handle(tid);
+	thread_cache &cache = get_thread_cache();
+	std::unique_lock<std::mutex> lock(cache.mtx);
+	auto it = cache.threads.find(static_cast<uint64_t>(_tid));
+
+	// 缓存线程只在执行本次任务时取消，空闲或已复用的线程不属于该任务
+	if (it != cache.threads.end())
+	{
+		return !it->second->running || thread_gen(tid) != it->second->gen || pthread_cancel(_tid) == 0;
+	}
+
+	lock.unlock();
+
 	if (thread_exsit(tid))
 	{
-		return pthread_cancel(tid) == 0;
+		return pthread_cancel(_tid) == 0;
 	}
 
 	return true;
@@ -193,20 +911,71 @@ bool thread_exsit(const uint64_t &tid)
 		return false;
 	}
 
-	int pthread_kill_err = pthread_kill(tid, 0);
+	{
+		thread_cache &cache = get_thread_cache();
+		std::unique_lock<std::mutex> lock(cache.mtx);
+		auto it = cache.threads.find(static_cast<uint64_t>(thread_handle(tid)));
 
-	if (ESRCH == pthread_kill_err)
-    {
-        return false;
-    }
-    else if (EINVAL == pthread_kill_err)
-    {
-        return false;
-    }
-    else
-    {
-        return true;
-    }
+		// 空闲的缓存线程视为已退出，已复用的线程代数不匹配
+		if (it != cache.threads.end()) return it->second->running && thread_gen(tid) == it->second->gen;
+	}
+
+	// 不是本组件创建的线程，分离线程退出后pthread_t失效，不能再用pthread_kill探测
+	return pthread_equal(pthread_self(), static_cast<pthread_t>(tid));
+}
+
+/**
+ * @brief 检测内核线程存活，只用于线程未正常通知退出时的确认
+ * 
+ * @param ktid 内核线程号
+ * @return true 线程存在
+ * @return false 线程不存在
+ */
+bool thread_kernel_alive(const int &ktid)
+{
+	if (ktid <= 0)
+	{
+		return false;
+	}
+
+	// 只向本进程的线程发送空信号，其他错误视为存活
+	return !(syscall(SYS_tgkill, getpid(), ktid, 0) < 0 && ESRCH == errno);
+}
+
+/**
+ * @brief 设置线程CPU亲和性
+ * 
+ * @param affinity CPU亲和性
+ * @param tid 线程号
+ * @return true 设置成功
+ * @return false 设置失败
+ */
+bool set_thread_affinity(const cpu_set_t &affinity, const uint64_t &tid)
+{
+	uint64_t run_id = tid != INVALID_PTHREAD_TID ? tid : thread_id();
+	pthread_t _tid = thread_handle(run_id);
+	thread_cache &cache = get_thread_cache();
+	std::unique_lock<std::mutex> lock(cache.mtx);
+	auto it = cache.threads.find(static_cast<uint64_t>(_tid));
+
+	// 线程已复用，不修改新任务的亲和性
+	if (it != cache.threads.end() && thread_gen(run_id) != it->second->gen)
+	{
+		return false;
+	}
+
+	if (pthread_setaffinity_np(_tid, sizeof(affinity), &affinity) != 0)
+	{
+		return false;
+	}
+
+	// 亲和性与缓存键不一致，任务结束后线程退出
+	if (it != cache.threads.end())
+	{
+		it->second->dirty = true;
+	}
+
+	return true;
 }
 
 } // namespace wotsen
@@ -14,6 +14,7 @@
 #include <cinttypes>
 #include <cstdio>
 #include <string>
+#include <sched.h>
 
 namespace wotsen
 {
@@ -40,22 +41,88 @@ enum thread_priority : int
 ///< 线程毁掉接口
 typedef void *(*thread_func)(void *);
 
+///< 不指定NUMA节点
+#define THREAD_NUMA_NODE_ANY -1
+
+///< 继承创建者的调度策略
+#define THREAD_SCHED_INHERIT -1
+
+#ifndef SCHED_DEADLINE
+	#define SCHED_DEADLINE 6
+#endif
+
+/**
+ * @brief 线程属性
+ * 
+ */
+struct thread_attr
+{
+	size_t stacksize;		///< 线程栈大小
+	int priority;			///< 线程优先级
+	cpu_set_t affinity;		///< CPU亲和性，空集为不限制
+	int numa_node;			///< 优先NUMA节点，线程栈从该节点分配，亲和性为空时绑定到该节点的CPU
+	int policy;				///< 调度策略，SCHED_*或THREAD_SCHED_INHERIT
+	int nice;				///< nice值，0为不修改
+	uint64_t dl_runtime;	///< SCHED_DEADLINE每周期运行时间，纳秒
+	uint64_t dl_deadline;	///< SCHED_DEADLINE相对截止时间，纳秒
+	uint64_t dl_period;		///< SCHED_DEADLINE周期，纳秒
+};
+
+///< 线程缓存默认上限
+#define THREAD_CACHE_MAX_IDLE 32
+///< 线程缓存默认空闲超时，毫秒
+#define THREAD_CACHE_IDLE_TIMEOUT 10000
+
+/**
+ * @brief 线程缓存统计
+ * 
+ */
+struct thread_cache_stat
+{
+	uint64_t hits;		///< 复用空闲线程次数
+	uint64_t misses;	///< 新建线程次数
+	uint64_t expired;	///< 空闲超时或超出上限退出的线程数
+	uint32_t idle;		///< 当前空闲线程数
+};
+
 ///< 创建线程
 bool create_thread(uint64_t *tid, const size_t &stacksize, const int &priority, thread_func fn, void *arg=nullptr);
+bool create_thread(uint64_t *tid, const struct thread_attr &attr, thread_func fn, void *arg=nullptr, int *policy=nullptr);
 
-///< 获取本线程的id
+///< 获取本线程的id，缓存线程的id高16位为运行代数，线程复用后旧id失效
 uint64_t thread_id(void);
 
+///< 获取本线程的内核线程号
+int thread_kernel_id(void);
+
+///< 获取线程CPU时间，纳秒
+bool thread_cpu_time(const uint64_t &tid, uint64_t &ns);
+
+///< 获取线程上下文切换次数
+bool thread_ctx_switches(const int &ktid, uint64_t &voluntary, uint64_t &involuntary);
+
 ///< 设置线程名
 void set_thread_name(const char *name, const uint64_t &tid=INVALID_PTHREAD_TID);
 
 ///< 获取线程名
-std::string &&get_thread_name(const uint64_t &tid=INVALID_PTHREAD_TID);
+std::string get_thread_name(const uint64_t &tid=INVALID_PTHREAD_TID);
 
 ///< 释放线程
 bool release_thread(const uint64_t &tid);
 
-///< 检测线程存活
+///< 检测线程存活，只识别本组件创建的线程和当前线程，不产生系统调用
 bool thread_exsit(const uint64_t &tid);
 
+///< 检测内核线程存活
+bool thread_kernel_alive(const int &ktid);
+
+///< 设置线程CPU亲和性
+bool set_thread_affinity(const cpu_set_t &affinity, const uint64_t &tid=INVALID_PTHREAD_TID);
+
+///< 设置线程缓存，max_idle为0时不缓存
+void set_thread_cache(const uint32_t &max_idle, const uint32_t &idle_timeout_ms);
+
+///< 获取线程缓存统计
+struct thread_cache_stat get_thread_cache_stat(void);
+
 } // namespace wotsen
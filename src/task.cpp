@@ -15,7 +15,10 @@
 #include <algorithm>
 #include "posix_thread.h"
 #include "task.h"
+#include "task_table.h"
 #include "task_auto_manage.h"
+#include "task_periodic.h"
+#include "task_coroutine.h"
 
 namespace wotsen
 {
@@ -28,18 +31,23 @@ namespace wotsen
 #error TASK_STACKSIZE defined not equal STACKSIZE
 #endif
 
+///< 批量创建时每个辅助线程至少创建的任务数量
+#define TASK_SPAWN_BATCH 64
+
 task_dbg_cb __dbg = nullptr;
 
-// 强制退出次数
-static const int MAX_CNT_TASK_FORCE_EXIT = 3;
+void *_task_run(TaskDesc *_task);
+
+// 当前线程执行的任务
+static thread_local TaskSelf tls_self;
 
-static void *_task_run(Task *taskImpl);
 
 bool Task::stop = false;
 uint32_t Task::max_tasks = 128;
 abnormal_task_do Task::except_fun = nullptr;
+std::atomic<std::chrono::milliseconds> Task::manage_period(TASK_SEC(1));
 
-Task::Task()
+Task::Task() : shards_(new TaskShards(max_tasks)), manage_ticks_(0), manage_total_(0), manage_max_(0)
 {
 	// 优先级校验
 	static_assert((int)e_max_task_pri_lv == (int)e_max_thread_pri_lv, "e_max_task_pri_lv != e_max_thread_pri_lv");
@@ -72,12 +80,15 @@ Task::~Task()
 	manage_exit_fut_.get();
 
 	// 强制所有任务退出
-	for (auto item : tasks_)
-	{
-		task_exit(item->tid);
-	}
+	std::vector<TaskDesc *> tasks;
+
+	shards_->for_each([&](TaskDesc *item) { tasks.push_back(item); });
+
+	exit_tasks(tasks, TASK_MS(1500));
 
-	tasks_.clear();
+	// 周期任务和协程任务已全部结束，停止调度线程
+	periodic_.reset();
+	co_.reset();
 }
 
 // 等待任务创建结束
@@ -87,25 +98,20 @@ void Task::wait(void)
 }
 
 // 查找任务
-std::shared_ptr<TaskDesc> Task::search_task(const uint64_t &tid) noexcept
+TaskDesc *Task::search_task(const uint64_t &tid) noexcept
 {
-	// std::unique_lock<std::mutex> lck(mtx_);
+	TaskDesc *item = shards_->find(tid);
 
-	for (auto item : tasks_)
+	if (nullptr == item)
 	{
-		if (tid == item->tid)
-		{
-			return item;
-		}
+		task_dbg("not find task = %ld!\n", tid);
 	}
 
-	task_dbg("not find task = %ld!\n", tid);
-
-	return static_cast<std::shared_ptr<TaskDesc>>(nullptr);
+	return item;
 }
 
 // 添加任务异常处理
-bool Task::add_e_action(const uint64_t &tid, const std::function<void()> &e_action)
+bool Task::add_e_action(const uint64_t &tid, TaskFunction<void()> &&e_action)
 {
 	auto item = search_task(tid);
 
@@ -113,13 +119,15 @@ bool Task::add_e_action(const uint64_t &tid, const std::function<void()> &e_acti
 
 	std::unique_lock<std::mutex> lck(item->mtx);
 
-	item->calls.e_action = e_action;
+	if (tid != item->tid) return false;
+
+	item->calls.e_action = std::move(e_action);
 
 	return true;
 }
 
 // 超时处理
-bool Task::add_timeout_action(const uint64_t &tid, const std::function<void()> &timeout)
+bool Task::add_timeout_action(const uint64_t &tid, TaskFunction<void()> &&timeout)
 {
 	auto item = search_task(tid);
 
@@ -127,13 +135,15 @@ bool Task::add_timeout_action(const uint64_t &tid, const std::function<void()> &
 
 	std::unique_lock<std::mutex> lck(item->mtx);
 
-	item->calls.timout_action = timeout;
+	if (tid != item->tid) return false;
+
+	item->calls.timout_action = std::move(timeout);
 
 	return true;
 }
 
 // 添加任务退出处理
-bool Task::add_clean(const uint64_t &tid, const std::function<void()> &clean)
+bool Task::add_clean(const uint64_t &tid, TaskFunction<void()> &&clean)
 {
 	auto item = search_task(tid);
 
@@ -141,15 +151,49 @@ bool Task::add_clean(const uint64_t &tid, const std::function<void()> &clean)
 
 	std::unique_lock<std::mutex> lck(item->mtx);
 
-	item->calls.clean = clean;
+	if (tid != item->tid) return false;
+
+	item->calls.clean = std::move(clean);
 
 	return true;
 }
 
+// 初始化任务描述
+static void task_desc_init(TaskDesc *task_desc, const TaskRegisterInfo &reg_info, TaskFunction<void()> &&task,
+						   const std::stop_source &stop)
+{
+	task_desc->reg_info = reg_info;
+	task_desc->calls.task = std::move(task);
+	task_desc->stop = stop;
+	task_desc->task_state.create_time = now();
+	task_desc->task_state.last_update_time.store(task_desc->task_state.create_time, std::memory_order_relaxed);
+	task_desc->task_state.timeout_times = 0;
+	task_desc->task_state.state.store(e_task_wait, std::memory_order_relaxed);
+	task_desc->quited = false;
+	task_desc->ktid = 0;
+	task_desc->wait_start.store(task_desc->task_state.create_time, std::memory_order_relaxed);
+	task_desc->wait_time.store(task_clock::duration::zero(), std::memory_order_relaxed);
+	task_desc->exec = e_task_exec_thread;
+	task_desc->counter.heartbeats.store(0, std::memory_order_relaxed);
+	task_desc->counter.overruns.store(0, std::memory_order_relaxed);
+
+	for (auto &item : task_desc->counter.heartbeat_hist) item.store(0, std::memory_order_relaxed);
+}
+
+// 没有线程的任务id取奇数，与pthread_t(对齐的地址)不会重复
+static uint64_t virtual_tid(void)
+{
+	static std::atomic<uint64_t> id(0);
+
+	return (id.fetch_add(1, std::memory_order_relaxed) + 1) << 1 | 1;
+}
+
 // 添加任务
-bool Task::add_task(uint64_t &tid, const TaskRegisterInfo &reg_info, const std::function<void()> &task)
+bool Task::add_task(uint64_t &tid, enum task_sched_policy &policy, const TaskRegisterInfo &reg_info, TaskFunction<void()> &&task,
+					const std::stop_source &stop)
 {
-	if (tasks_.size() >= max_tasks)
+	// 任务数量上限可能在初始化后调整
+	if (!shards_->acquire(1, max_tasks))
 	{
 		task_dbg("task full.\n");
 		return false;
@@ -157,33 +201,249 @@ bool Task::add_task(uint64_t &tid, const TaskRegisterInfo &reg_info, const std::
 
 	uint64_t _tid = INVALID_TASK_ID;
 	// 资源申请
-	std::shared_ptr<TaskDesc> task_desc(new TaskDesc);
-	std::unique_lock<std::mutex> lck(mtx_);
+	TaskDesc *task_desc = shards_->alloc();
+
+	// 任务描述记录，线程启动后直接使用描述符
+	task_desc_init(task_desc, reg_info, std::move(task), stop);
 
-	// 创建线程
-	if (!create_thread(&_tid, reg_info.task_attr.stacksize, reg_info.task_attr.priority, (thread_func)_task_run, this))
+	// 锁外创建线程，线程启动后等待task_run，不会访问未发布的状态
+	if (!_create_util_task(&_tid, reg_info.task_attr, (task_util_call)_task_run, task_desc, &policy))
     {
 		task_dbg("create thread failed.\n");
+		shards_->release(task_desc);
         return false;
     }
 
+	tid = _tid;
+
+	// 只锁tid所在的分片
+	TaskShard &shard = shards_->of(_tid);
+	std::unique_lock<std::mutex> lck(shard.mtx);
+
+	publish(shard, task_desc, _tid);
+
+	return true;
+}
+
+void Task::publish(TaskShard &shard, TaskDesc *task_desc, const uint64_t &tid)
+{
 	// 查找队列中是否有相同id的任务，如果有则认为是已经退出，删除任务
-	del_task(_tid);
+	del_task(shard, tid);
+
+	task_desc->tid = tid;
+
+	// 分片不均时扩容
+	shard.table.reserve(shard.table.size() + 1);
+	shard.table.insert(task_desc);
+
+	// 交给任务管理检测超时
+	shard.joined.push_back({task_desc, task_desc->gen});
+}
+
+// 在[begin, end)范围内创建任务线程，失败的tid为INVALID_TASK_ID
+static void spawn_tasks(const std::vector<TaskDesc *> &descs, std::vector<uint64_t> &tids,
+						std::vector<enum task_sched_policy> &policies, const size_t &begin, const size_t &end)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		if (!_create_util_task(&tids[i], descs[i]->reg_info.task_attr, (task_util_call)_task_run, descs[i], &policies[i]))
+		{
+			task_dbg("create thread failed.\n");
+			tids[i] = INVALID_TASK_ID;
+		}
+	}
+}
+
+// 批量添加任务
+bool Task::add_tasks(std::span<const TaskRegisterInfo> reg_infos, std::vector<TaskFunction<void()>> &tasks,
+					 const std::vector<std::stop_source> &stops, std::vector<uint64_t> &tids, std::vector<enum task_sched_policy> &policies)
+{
+	size_t count = reg_infos.size();
+	std::vector<TaskDesc *> descs(count);
+
+	// 发布前占用任务数量
+	if (!shards_->acquire(count, max_tasks))
+	{
+		task_dbg("task full.\n");
+		return false;
+	}
+
+	// 一次加锁申请所有描述符
+	shards_->alloc(descs);
+
+	for (size_t i = 0; i < count; i++) task_desc_init(descs[i], reg_infos[i], std::move(tasks[i]), stops[i]);
+
+	// 锁外创建线程，数量多时分段并行创建，线程启动后等待task_run，不会访问未发布的状态
+	size_t helpers = std::min<size_t>(std::thread::hardware_concurrency(), count / TASK_SPAWN_BATCH);
+	size_t step = helpers > 1 ? (count + helpers - 1) / helpers : count;
+	std::vector<TaskKey<void>> spawners;
+	TaskAttribute attr;
+
+	attr.task_name = "task spawn";
+
+	for (size_t begin = step; begin < count; begin += step)
+	{
+		size_t end = std::min(begin + step, count);
+		auto key = new_task(attr, [&, begin, end]() { spawn_tasks(descs, tids, policies, begin, end); });
+
+		// 辅助线程创建失败则在当前线程创建
+		if (INVALID_TASK_ID == key.tid)
+		{
+			spawn_tasks(descs, tids, policies, begin, end);
+			continue;
+		}
+
+		spawners.push_back(std::move(key));
+	}
+
+	spawn_tasks(descs, tids, policies, 0, std::min(step, count));
+
+	for (auto &item : spawners) item.fut.wait();
+
+	std::vector<size_t> order;
+
+	order.reserve(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		// 返回值置为broken_promise
+		if (INVALID_TASK_ID == tids[i])
+		{
+			shards_->release(descs[i]);
+			continue;
+		}
+
+		order.push_back(i);
+	}
+
+	// 按分片分组，每个分片加锁一次发布
+	std::sort(order.begin(), order.end(), [&](const size_t &a, const size_t &b) {
+		return &shards_->of(tids[a]) < &shards_->of(tids[b]);
+	});
+
+	for (size_t i = 0; i < order.size();)
+	{
+		TaskShard &shard = shards_->of(tids[order[i]]);
+		std::unique_lock<std::mutex> lck(shard.mtx);
+
+		for (; i < order.size() && &shards_->of(tids[order[i]]) == &shard; i++)
+		{
+			publish(shard, descs[order[i]], tids[order[i]]);
+		}
+	}
+
+	return true;
+}
+
+// 添加周期任务
+bool Task::add_periodic(TaskKey<void> &key, const TaskRegisterInfo &reg_info, const std::chrono::nanoseconds &period, TaskFunction<void()> &&fn)
+{
+	if (period <= std::chrono::nanoseconds::zero()) return false;
+
+	// 每个周期执行完才心跳，存活时间不大于周期时健康的任务也会超时
+	if (reg_info.alive_time <= period)
+	{
+		task_dbg("periodic task [%s] alive time must be longer than period.\n", reg_info.task_attr.task_name.c_str());
+		return false;
+	}
+
+	{
+		std::unique_lock<std::mutex> lck(mtx_);
+
+		// 首个周期任务时启动定时线程
+		if (!periodic_)
+		{
+			try
+			{
+				periodic_.reset(new TaskPeriodic);
+			}
+			catch (std::exception &e)
+			{
+				task_dbg("%s\n", e.what());
+				return false;
+			}
+		}
+	}
+
+	if (!shards_->acquire(1, max_tasks))
+	{
+		task_dbg("task full.\n");
+		return false;
+	}
+
+	uint64_t _tid = virtual_tid();
+	TaskDesc *task_desc = shards_->alloc();
+	TaskPromise<void> done;
+
+	task_desc_init(task_desc, reg_info, nullptr, std::stop_source(std::nostopstate));
+	task_desc->exec = e_task_exec_periodic;
+
+	key.fut = done.get_future();
+	key.tid = _tid;
+	key.policy = periodic_->policy();
+
+	TaskRef ref{task_desc, task_desc->gen};
+
+	// 发布
+	{
+		TaskShard &shard = shards_->of(_tid);
+		std::unique_lock<std::mutex> lck(shard.mtx);
+
+		publish(shard, task_desc, _tid);
+	}
+
+	periodic_->add(ref, period, std::move(fn), std::move(done));
+
+	return true;
+}
+
+// 添加协程任务
+bool Task::add_coroutine(uint64_t &tid, const TaskRegisterInfo &reg_info, const std::shared_ptr<TaskCoContext> &ctx)
+{
+	{
+		std::unique_lock<std::mutex> lck(mtx_);
+
+		// 首个协程任务时启动工作线程
+		if (!co_)
+		{
+			try
+			{
+				co_.reset(new TaskCoScheduler);
+			}
+			catch (std::exception &e)
+			{
+				task_dbg("%s\n", e.what());
+				return false;
+			}
+		}
+	}
+
+	if (!shards_->acquire(1, max_tasks))
+	{
+		task_dbg("task full.\n");
+		return false;
+	}
+
+	uint64_t _tid = virtual_tid();
+	TaskDesc *task_desc = shards_->alloc();
+
+	task_desc_init(task_desc, reg_info, nullptr, std::stop_source(std::nostopstate));
+	task_desc->exec = e_task_exec_coroutine;
+
+	ctx->ref = {task_desc, task_desc->gen};
+	ctx->tid = _tid;
+	ctx->sched = co_.get();
+
+	// 先交给调度，task_run时才开始执行
+	co_->add(ctx);
 
 	tid = _tid;
 
-	// 任务描述记录
-	task_desc->tid = _tid;
-	task_desc->reg_info = reg_info;
-	task_desc->reg_info.task_attr.task_name = reg_info.task_attr.task_name;
-	task_desc->calls.task = task;
-	task_desc->task_state.create_time = now();
-	task_desc->task_state.last_update_time = task_desc->task_state.create_time;
-	task_desc->task_state.timeout_times = 0;
-	task_desc->task_state.state = e_task_wait;
+	// 发布
+	TaskShard &shard = shards_->of(_tid);
+	std::unique_lock<std::mutex> lck(shard.mtx);
 
-	// 入栈
-	tasks_.push_back(task_desc);
+	publish(shard, task_desc, _tid);
 
 	return true;
 }
@@ -195,7 +455,7 @@ void Task::task_run(const uint64_t &tid)
 }
 
 // 任务结束
-void Task::task_exit(const uint64_t &tid)
+void Task::task_exit(const uint64_t &tid, const std::chrono::milliseconds &timeout)
 {
 	auto _task = task_ptr()->search_task(tid);
 
@@ -204,51 +464,104 @@ void Task::task_exit(const uint64_t &tid)
 		return ;
     }
 
-	std::unique_lock<std::mutex> lock(_task->mtx);
+	task_ptr()->exit_tasks({_task}, timeout);
+}
+
+// 结束所有任务
+void Task::task_exit_all(const std::chrono::milliseconds &timeout)
+{
+	auto &task = task_ptr();
+	std::vector<TaskDesc *> tasks;
+
+	tasks.reserve(task->shards_->size());
+	task->shards_->for_each([&](TaskDesc *item) { tasks.push_back(item); });
 
-	if (e_task_stop == _task->task_state.state || e_task_dead == _task->task_state.state) return;
+	task->exit_tasks(tasks, timeout);
+}
 
-	// 先修改状态
-	_task->task_state.state = e_task_stop;
+void Task::exit_tasks(const std::vector<TaskDesc *> &tasks, const std::chrono::milliseconds &timeout)
+{
+	/**
+	 * @brief 待退出任务
+	 * 
+	 */
+	struct TaskStop
+	{
+		TaskRef ref;			///< 任务引用
+		uint64_t tid;			///< 任务id
+		std::stop_source stop;	///< 停止请求
+	};
 
-	// 解锁，等任务自己检测到退出状态
-	lock.unlock();
+	std::vector<TaskStop> stops;
 
-	// 检测线程存活，如果存活等3次500ms后强制终止
-	int cnt = MAX_CNT_TASK_FORCE_EXIT;
+	stops.reserve(tasks.size());
 
-	while (cnt-- && thread_exsit(tid))
+	// 先修改所有任务状态
+	for (auto item : tasks)
 	{
-		std::this_thread::sleep_for(std::chrono::milliseconds(500));
-	}
+		std::unique_lock<std::mutex> lock(item->mtx);
+
+		// 已从任务表移除，槽在分片锁内写，这里只持有任务锁，需原子读
+		if (INVALID_TASK_SLOT == item->slot.load(std::memory_order_acquire)) continue;
+
+		if (e_task_stop == item->task_state.state || e_task_dead == item->task_state.state) continue;
 
-	// 强制退出
-	if (thread_exsit(tid)) {
-		task_dbg("force destroy task [%ld].\n", tid);
-		release_thread(tid);
+		item->task_state.state = e_task_stop;
+
+		// 唤醒暂停中的任务，让其检测到退出状态
+		item->parker.unpark();
+
+		// 周期任务由定时线程结束，挂起中的协程任务恢复执行以检测到退出状态
+		if (e_task_exec_periodic == item->exec) periodic_->stop(item->tid);
+		if (e_task_exec_coroutine == item->exec) co_->stop(item->tid);
+
+		stops.push_back({{item, item->gen}, item->tid, item->stop});
 	}
 
-	lock.lock();
+	// 锁外请求停止，停止回调中可以访问任务接口；睡眠、条件变量和停止事件上的等待立即被唤醒
+	for (auto &item : stops) item.stop.request_stop();
+
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+
+	// 等任务自己检测到退出状态，所有任务共用截止时间
+	for (auto &item : stops)
+	{
+		TaskDesc *_task = item.ref.task;
+		std::unique_lock<std::mutex> lock(_task->mtx);
+
+		_task->quit_cond.wait_until(lock, deadline, [&]() {
+			return item.ref.gen != _task->gen || _task->quited;
+		});
 
-	// 执行清理工作
-	if (_task->calls.clean) _task->calls.clean();
+		// 期间已被任务管理清理
+		if (item.ref.gen != _task->gen) continue;
 
-	std::vector<std::shared_ptr<TaskDesc>> &tasks_ = task_ptr()->tasks_;
+		// 未退出的任务需要强制结束，周期任务无法强制结束
+		bool force = !_task->quited && e_task_exec_periodic != _task->exec;
+		enum task_exec exec = _task->exec;
 
-	std::unique_lock<std::mutex> t_lock(task_ptr()->mtx_);
+		// 执行清理工作，不持有任务锁
+		TaskFunction<void()> clean = std::move(_task->calls.clean);
 
-	// 移除队列
-	tasks_.erase(std::remove_if(tasks_.begin(),
-								tasks_.end(),
-								[&](auto &item) -> bool {
-									if (_task->tid == item->tid)
-									{
-										return true;
-									}
+		// 强制取消前释放任务锁，被取消的线程可能正阻塞在任务接口上等这把锁
+		lock.unlock();
 
-									return false;
-								}),
-				tasks_.end());
+		if (force && e_task_exec_thread == exec)
+		{
+			task_dbg("force destroy task [%ld].\n", item.tid);
+			release_thread(item.tid);
+		}
+		else if (force && e_task_exec_coroutine == exec)
+		{
+			task_dbg("force destroy task [%ld].\n", item.tid);
+			co_->destroy(item.tid);
+		}
+
+		if (clean) clean();
+	}
+
+	// 逐个从所在分片移除，期间已被任务管理清理的跳过
+	for (auto &item : stops) shards_->erase(item.ref);
 }
 
 // 任务心跳
@@ -261,20 +574,143 @@ bool Task::task_alive(const uint64_t &tid)
 		return false;
     }
 
-	std::unique_lock<std::mutex> lock(_task->mtx);
+	return wait_alive(_task, tid);
+}
 
-	// 如果是等待则一直休眠
-	while (e_task_wait == _task->task_state.state) _task->condition.wait(lock);
+bool Task::wait_alive(TaskDesc *_task, const uint64_t &tid)
+{
+	enum task_state state = _task->task_state.state.load(std::memory_order_acquire);
+
+	// 如果是等待则挂起到继续或结束，不加锁
+	if (e_task_wait == state)
+	{
+		_task->parker.park([&]() {
+			state = _task->task_state.state.load(std::memory_order_acquire);
+
+			return tid != _task->tid || e_task_wait != state;
+		});
+	}
 
 	// 如果是非存活状态则直接返回
-	if (e_task_alive != _task->task_state.state) return false;
+	if (e_task_alive != state || tid != _task->tid) return false;
 
-	// 更新时间
-	_task->task_state.last_update_time = now();
+	// 任务自己的线程调用时是单写者
+	heartbeat(_task, tls_self.ref_.task != _task);
+
+	return true;
+}
+
+TaskSelf &Task::self(void) noexcept
+{
+	return tls_self;
+}
+
+bool TaskSelf::alive(void)
+{
+	if (!owned()) return false;
+
+	// 周期任务和协程任务在共享线程上执行，暂停时不阻塞
+	if (e_task_exec_thread != ref_.task->exec)
+	{
+		enum task_state state = ref_.task->task_state.state.load(std::memory_order_acquire);
+
+		if (e_task_wait == state) return true;
+
+		if (e_task_alive != state) return false;
+
+		Task::heartbeat(ref_.task, false);
+
+		return true;
+	}
+
+	return Task::wait_alive(ref_.task, tid_);
+}
+
+TaskSelfScope::TaskSelfScope(const TaskRef &ref, const uint64_t &tid) : prev_(std::move(tls_self))
+{
+	tls_self.ref_ = ref;
+	tls_self.tid_ = tid;
+	tls_self.name_ = ref.task->reg_info.task_attr.task_name;
+	// 停止状态只由本任务的执行线程创建，这里不用加锁；还没有时留空，首次取令牌时创建
+	tls_self.stop_ = TaskStopToken(ref.task->stop.get_token());
+}
+
+void TaskSelf::load_stop(void)
+{
+	TaskDesc *task = ref_.task;
+	std::unique_lock<std::mutex> lock(task->mtx);
+
+	if (!owned()) return;
+
+	if (!task->stop.stop_possible())
+	{
+		task->stop = std::stop_source();
+
+		// 创建前已请求停止的任务，exit_tasks和任务管理先置状态再在锁外请求，这里补上
+		enum task_state state = task->task_state.state.load(std::memory_order_acquire);
+
+		if (e_task_stop == state || e_task_dead == state) task->stop.request_stop();
+	}
+
+	stop_ = TaskStopToken(task->stop.get_token());
+}
+
+TaskSelfScope::~TaskSelfScope()
+{
+	tls_self = std::move(prev_);
+}
+
+// 任务进度心跳
+bool Task::task_progress(const uint64_t &tid)
+{
+	auto _task = task_ptr()->search_task(tid);
+
+	if (nullptr == _task)
+    {
+		return false;
+    }
+
+	enum task_state state = _task->task_state.state.load(std::memory_order_acquire);
+
+	if (tid != _task->tid) return false;
+
+	// 暂停中的任务不检测超时，不用心跳
+	if (e_task_wait == state) return true;
+
+	if (e_task_alive != state) return false;
+
+	// 反应器工作线程可能同时为同一任务心跳
+	heartbeat(_task, true);
 
 	return true;
 }
 
+void Task::heartbeat(TaskDesc *task, const bool &shared) noexcept
+{
+	task_time_t _now = now();
+	task_time_t last = task->task_state.last_update_time.load(std::memory_order_relaxed);
+
+	// 更新时间
+	task->task_state.last_update_time.store(_now, std::memory_order_relaxed);
+
+	// 心跳间隔计数
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(_now - last).count();
+	uint32_t bucket = ms <= 0 ? 0 : std::min<uint32_t>(TASK_HEARTBEAT_BUCKETS - 1, 64 - __builtin_clzll(ms));
+	TaskCounter &counter = task->counter;
+
+	// 多写者(反应器、其他线程调用task_alive(tid))用原子加，不丢计数
+	if (shared)
+	{
+		counter.heartbeats.fetch_add(1, std::memory_order_relaxed);
+		counter.heartbeat_hist[bucket].fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// 任务自己的线程是单写者，普通读写即可，不加总线锁；与多写者并发时可能少计几次
+	counter.heartbeats.store(counter.heartbeats.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	counter.heartbeat_hist[bucket].store(counter.heartbeat_hist[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
 // 任务暂停
 void Task::task_wait(const uint64_t &tid)
 {
@@ -285,10 +721,7 @@ void Task::task_wait(const uint64_t &tid)
 		return ;
     }
 
-	std::unique_lock<std::mutex> lock(_task->mtx);
-
-	// 修改状态
-	if (e_task_alive == _task->task_state.state) _task->task_state.state = e_task_wait;
+	pause(_task, tid, now());
 }
 
 // 任务继续
@@ -301,19 +734,146 @@ void Task::task_continue(const uint64_t &tid)
 		return ;
     }
 
+	resume(_task, tid, now());
+}
+
+// 批量暂停
+size_t Task::task_wait(std::span<const uint64_t> tids)
+{
+	auto &task = task_ptr();
+	task_time_t _now = now();
+	size_t count = 0;
+
+	for (auto &tid : tids)
+	{
+		TaskDesc *_task = task->search_task(tid);
+
+		if (_task && pause(_task, tid, _now)) count++;
+	}
+
+	return count;
+}
+
+// 批量继续
+size_t Task::task_continue(std::span<const uint64_t> tids)
+{
+	auto &task = task_ptr();
+	task_time_t _now = now();
+	size_t count = 0;
+
+	for (auto &tid : tids)
+	{
+		TaskDesc *_task = task->search_task(tid);
+
+		if (_task && resume(_task, tid, _now)) count++;
+	}
+
+	return count;
+}
+
+bool Task::pause(TaskDesc *_task, const uint64_t &tid, const task_time_t &_now) noexcept
+{
+	if (tid != _task->tid) return false;
+
+	enum task_state expected = e_task_alive;
+
+	// 只有存活状态才能暂停，先记录时间再切换状态
+	if (e_task_alive != _task->task_state.state.load(std::memory_order_relaxed)) return false;
+
+	_task->wait_start.store(_now, std::memory_order_relaxed);
+
+	return _task->task_state.state.compare_exchange_strong(expected, e_task_wait, std::memory_order_acq_rel);
+}
+
+bool Task::resume(TaskDesc *_task, const uint64_t &tid, const task_time_t &_now)
+{
+	if (tid != _task->tid) return false;
+
+	enum task_state expected = e_task_wait;
+
+	// 只有等待状态才能切换到继续执行，与结束并发时以先修改的为准
+	if (!_task->task_state.state.compare_exchange_strong(expected, e_task_alive, std::memory_order_acq_rel)) return false;
+
+	_task->wait_time.store(_task->wait_time.load(std::memory_order_relaxed) + (_now - _task->wait_start.load(std::memory_order_relaxed)),
+						   std::memory_order_relaxed);
+	_task->task_state.last_update_time.store(_now, std::memory_order_relaxed);
+
+	_task->parker.unpark();
+
+	// 协程任务没有阻塞的线程，需要重新调度
+	if (e_task_exec_coroutine == _task->exec) task_ptr()->co_->resume_parked(tid);
+
+	return true;
+}
+
+// 设置任务CPU亲和性
+bool Task::set_affinity(const uint64_t &tid, const cpu_set_t &affinity)
+{
+	auto _task = task_ptr()->search_task(tid);
+
+	if (nullptr == _task)
+    {
+		return false;
+    }
+
+	// 持有任务锁时线程不会退出，不会设置到复用的线程上
 	std::unique_lock<std::mutex> lock(_task->mtx);
 
-	// 只有等待状态才能切换到继续执行
-	if (e_task_wait != _task->task_state.state) return;
+	// 周期任务和协程任务没有独立线程
+	if (tid != _task->tid || _task->quited || e_task_exec_thread != _task->exec) return false;
+
+	if (!set_task_affinity(affinity, tid)) return false;
 
-	_task->task_state.last_update_time = now();
-	_task->task_state.state = e_task_alive;
+	_task->reg_info.task_attr.affinity = affinity;
 
-	_task->condition.notify_one();
+	return true;
 }
 
-// 任务是否存活
-bool Task::is_task_alive(const uint64_t &tid)
+bool Task::collect_metrics(TaskDesc *task, TaskMetrics &metrics)
+{
+	uint64_t tid = task->tid;
+	uint64_t cpu_ns = 0;
+
+	if (INVALID_TASK_ID == tid) return false;
+
+	task_time_t _now = now();
+	task_clock::duration wait_time = task->wait_time.load(std::memory_order_relaxed);
+
+	metrics.tid = tid;
+	metrics.task_name = task->reg_info.task_attr.task_name;
+	metrics.state = task->task_state.state.load(std::memory_order_relaxed);
+	metrics.timeout_times = task->task_state.timeout_times;
+	metrics.uptime = _now - task->task_state.create_time;
+
+	// 正在等待
+	if (e_task_wait == metrics.state) wait_time += _now - task->wait_start.load(std::memory_order_relaxed);
+
+	metrics.wait_time = wait_time;
+	metrics.cpu_time = std::chrono::nanoseconds::zero();
+	metrics.voluntary_switches = 0;
+	metrics.involuntary_switches = 0;
+
+	// 线程未退出时才能访问线程资源
+	if (!task->quited && task->ktid)
+	{
+		if (thread_cpu_time(tid, cpu_ns)) metrics.cpu_time = std::chrono::nanoseconds(cpu_ns);
+
+		thread_ctx_switches(task->ktid, metrics.voluntary_switches, metrics.involuntary_switches);
+	}
+
+	metrics.heartbeats = task->counter.heartbeats.load(std::memory_order_relaxed);
+	metrics.overruns = task->counter.overruns.load(std::memory_order_relaxed);
+
+	for (uint32_t i = 0; i < TASK_HEARTBEAT_BUCKETS; i++)
+	{
+		metrics.heartbeat_hist[i] = task->counter.heartbeat_hist[i].load(std::memory_order_relaxed);
+	}
+
+	return true;
+}
+
+// 获取任务运行指标
+bool Task::task_metrics(const uint64_t &tid, TaskMetrics &metrics)
 {
 	auto _task = task_ptr()->search_task(tid);
 
@@ -324,8 +884,87 @@ bool Task::is_task_alive(const uint64_t &tid)
 
 	std::unique_lock<std::mutex> lock(_task->mtx);
 
-	// 检测状态与实际线程
-	return e_task_alive == _task->task_state.state && thread_exsit(tid);
+	if (tid != _task->tid) return false;
+
+	return collect_metrics(_task, metrics);
+}
+
+// 获取所有任务运行指标
+std::vector<TaskMetrics> Task::task_metrics(void)
+{
+	auto &task = task_ptr();
+	std::vector<TaskRef> refs;
+	std::vector<TaskMetrics> metrics;
+
+	refs.reserve(task->shards_->size());
+
+	// 无锁遍历任务表
+	task->shards_->for_each([&](TaskDesc *item) { refs.push_back({item, item->gen}); });
+
+	metrics.resize(refs.size());
+
+	size_t cnt = 0;
+
+	// 逐个任务加锁采集
+	for (auto &ref : refs)
+	{
+		std::unique_lock<std::mutex> lock(ref.task->mtx);
+
+		if (ref.gen != ref.task->gen) continue;
+
+		if (collect_metrics(ref.task, metrics[cnt])) cnt++;
+	}
+
+	metrics.resize(cnt);
+
+	return metrics;
+}
+
+// 获取所有任务id
+std::vector<uint64_t> Task::task_list(void)
+{
+	auto &task = task_ptr();
+	std::vector<uint64_t> tids;
+
+	tids.reserve(task->shards_->size());
+
+	// 无锁遍历任务表，已解除索引的任务不返回
+	task->shards_->for_each([&](TaskDesc *item) {
+		uint64_t tid = item->tid;
+
+		if (INVALID_TASK_ID != tid) tids.push_back(tid);
+	});
+
+	return tids;
+}
+
+// 任务管理线程统计，tick次数及单次tick的累计、最大耗时
+TaskManageStat Task::manage_stat(void)
+{
+	auto &task = task_ptr();
+	TaskManageStat stat;
+
+	stat.ticks = task->manage_ticks_.load(std::memory_order_relaxed);
+	stat.total = std::chrono::nanoseconds(task->manage_total_.load(std::memory_order_relaxed));
+	stat.max = std::chrono::nanoseconds(task->manage_max_.load(std::memory_order_relaxed));
+
+	return stat;
+}
+
+// 任务是否存活
+bool Task::is_task_alive(const uint64_t &tid)
+{
+	auto _task = task_ptr()->search_task(tid);
+
+	if (nullptr == _task)
+    {
+		return false;
+    }
+
+	// 线程返回、抛出异常或被取消时都会设置退出标记，不用再探测线程
+	return e_task_alive == _task->task_state.state.load(std::memory_order_acquire)
+			&& tid == _task->tid
+			&& !_task->quited.load(std::memory_order_acquire);
 }
 
 // 获取任务状态
@@ -338,7 +977,12 @@ enum task_state Task::task_state(const uint64_t &tid)
 		return e_task_stop;
     }
 
-	return _task->task_state.state;
+	enum task_state state = _task->task_state.state.load(std::memory_order_acquire);
+
+	// 描述符已复用
+	if (tid != _task->tid) return e_task_stop;
+
+	return state;
 }
 
 std::shared_ptr<Task> &Task::task_ptr(void)
@@ -348,62 +992,100 @@ std::shared_ptr<Task> &Task::task_ptr(void)
 	return task_instance;
 }
 
-void Task::task_init(const uint32_t &max_tasks, abnormal_task_do except_fun)
+void Task::task_init(const uint32_t &max_tasks,
+					 abnormal_task_do except_fun,
+					 const std::chrono::milliseconds &manage_period)
 {
 	Task::max_tasks = max_tasks;
 	Task::except_fun = except_fun;
+	// 周期不能为0
+	Task::manage_period = manage_period > TASK_MS(0) ? manage_period : TASK_MS(1);
 }
 
-void Task::del_task(const uint64_t &tid)
+void Task::task_quit(const TaskRef &ref)
 {
-	for (auto item : tasks_)
-	{
-		std::unique_lock<std::mutex> lck(item->mtx);
+	std::unique_lock<std::mutex> i_lock(ref.task->mtx);
 
-		if (tid == item->tid)
-		{
-			// 只是将任务id标记为无效，有任务管理进行处理
-			item->tid = INVALID_TASK_ID;
-			break;
-		}
-	}
+	// 描述符已被清理复用，不需要再交给任务管理
+	if (ref.gen != ref.task->gen) return;
+
+	// 通知等待退出的task_exit
+	ref.task->quited.store(true, std::memory_order_release);
+	ref.task->quit_cond.notify_all();
+
+	uint32_t shard = ref.task->shard;
+
+	i_lock.unlock();
+
+	// 任务组件正在析构
+	if (Task::stop) return;
+
+	TaskShard &_shard = task_ptr()->shards_->at(shard);
+	std::unique_lock<std::mutex> lck(_shard.mtx);
+
+	_shard.quited.push_back(ref);
+}
+
+void Task::del_task(TaskShard &shard, const uint64_t &tid)
+{
+	TaskDesc *item = shard.table.find(tid);
+
+	if (nullptr == item) return;
+
+	std::unique_lock<std::mutex> lck(item->mtx);
+
+	// 只是将任务id标记为无效，有任务管理进行处理
+	shard.table.unlink(item);
+
+	// 暂停中的任务检测到id变化后结束
+	item->parker.unpark();
 }
 
 /**
  * @brief 任务运行
  *
- * @param tasks : 任务管理器
+ * @param _task : 任务描述
  *
  * @return : none
  */
-static void *_task_run(Task *taskImpl)
+void *_task_run(TaskDesc *_task)
 {
-    uint64_t tid = thread_id();
-
-    // 等线程加入任务池
-	taskImpl->wait();
-
-    auto _task = taskImpl->search_task(tid);
+	/**
+	 * @brief 线程退出通知，任务返回、抛出异常或线程被取消时都会执行
+	 * 
+	 */
+	struct TaskQuitNotify
+	{
+		TaskRef ref;
 
-    if (nullptr == _task)
-    {
-		task_dbg("not find task info = %ld can not run task!\n", tid);
-        return (void *)0;
-    }
+		~TaskQuitNotify() { Task::task_quit(ref); }
+	} notify{{_task, _task->gen}};
 
     set_thread_name(_task->reg_info.task_attr.task_name.c_str());
 
 	std::unique_lock<std::mutex> lck(_task->mtx);
 
+	_task->ktid = thread_kernel_id();
+
+	lck.unlock();
+
 	// 等待任务启动
-	while (e_task_wait == _task->task_state.state) _task->condition.wait(lck);
+	_task->parker.park([_task]() { return e_task_wait != _task->task_state.state.load(std::memory_order_acquire); });
+
+	lck.lock();
 
 	task_dbg("task %s run.\n", _task->reg_info.task_attr.task_name.c_str());
 
+	// 取出任务调用，描述符可能在任务运行期间被任务管理回收
+	auto task = std::move(_task->calls.task);
+
+	// 启动时任务已发布，tid有效
+	TaskSelfScope self(notify.ref, _task->tid);
+
 	lck.unlock();
 
 	// 实际任务调用
-    _task->calls.task();
+    task();
 
     return (void *)0;
 }
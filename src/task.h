@@ -13,27 +13,56 @@
 
 #include <cstdio>
 #include <cinttypes>
+#include <ctime>
+#include <chrono>
 #include <string>
 #include <functional>
 #include <type_traits>
 #include <memory>
+#include <atomic>
+#include <span>
 #include <vector>
 #include <mutex>
 #include <condition_variable>
 #include <exception>
 #include "task_utils.h"
+#include "task_park.h"
+#include "task_stop.h"
 
 namespace wotsen
 {
 
-// using task_time_t = std::chrono::system_clock::time_point;
+/**
+ * @brief 任务时钟
+ * 
+ * [NOTE]:使用CLOCK_MONOTONIC_COARSE，不受系统时间跳变影响，读取开销低，精度为一个时钟节拍(1~4ms)
+ */
+struct task_clock
+{
+	using duration = std::chrono::nanoseconds;
+	using rep = duration::rep;
+	using period = duration::period;
+	using time_point = std::chrono::time_point<task_clock, duration>;
+	static constexpr bool is_steady = true;
 
-// #define TASK_NS(n) std::chrono::nanoseconds(n)
-// #define TASK_US(n) std::chrono::microseconds(n)
-// #define TASK_MS(n) std::chrono::milliseconds(n)
-// #define TASK_SEC(n) std::chrono::seconds(n)
-// #define TASK_MIN(n) std::chrono::minutes(n)
-// #define TASK_HOUR(n) std::chrono::hours(n)
+	static time_point now(void) noexcept
+	{
+		struct timespec ts;
+
+		clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+
+		return time_point(duration(static_cast<rep>(ts.tv_sec) * 1000000000 + ts.tv_nsec));
+	}
+};
+
+using task_time_t = task_clock::time_point;
+
+#define TASK_NS(n) std::chrono::nanoseconds(n)
+#define TASK_US(n) std::chrono::microseconds(n)
+#define TASK_MS(n) std::chrono::milliseconds(n)
+#define TASK_SEC(n) std::chrono::seconds(n)
+#define TASK_MIN(n) std::chrono::minutes(n)
+#define TASK_HOUR(n) std::chrono::hours(n)
 
 /**
  * @brief 任务崩溃处理
@@ -61,6 +90,17 @@ enum task_state
 	e_task_dead,	///< 死亡
 };
 
+/**
+ * @brief 任务执行方式
+ * 
+ */
+enum task_exec
+{
+	e_task_exec_thread,	   ///< 独立线程
+	e_task_exec_periodic,  ///< 周期任务，在共享定时线程上执行
+	e_task_exec_coroutine, ///< 协程任务，在协程工作线程上执行
+};
+
 /**
  * @brief 任务注冊信息
  * 
@@ -69,7 +109,7 @@ struct TaskRegisterInfo
 {
 	// [NOTE]:不要使用memcpy拷贝
 	TaskAttribute task_attr;		  ///< 任务属性
-	time_t alive_time;				  ///< 存活时间
+	std::chrono::milliseconds alive_time; ///< 存活时间
 	enum task_except_action e_action; ///< 异常动作
 };
 
@@ -90,22 +130,71 @@ struct TaskExceptInfo
  */
 struct TaskCall
 {
-	std::function<void()> task;			 ///< 任务接口
-	std::function<void()> e_action;		 ///< 异常接口
-	std::function<void()> timout_action; ///< 超时接口
-	std::function<void()> clean;		 ///< 清理接口
+	TaskFunction<void()> task;			///< 任务接口
+	TaskFunction<void()> e_action;		///< 异常接口
+	TaskFunction<void()> timout_action; ///< 超时接口
+	TaskFunction<void()> clean;			///< 清理接口
 };
 
 /**
  * @brief 任务状态
  * 
+ * [NOTE]:心跳只对state和last_update_time做原子读写，独占缓存行，避免与任务锁伪共享
+ */
+struct alignas(64) TaskState
+{
+	std::atomic<enum task_state> state;	  ///< 线程状态
+	std::atomic<task_time_t> last_update_time; ///< 上次更新时间
+	task_time_t create_time;					   ///< 创建时间
+	uint8_t timeout_times;				  ///< 超时次数，仅任务管理访问
+};
+
+///< 心跳间隔直方图桶数，第0桶小于1ms，第i桶为[2^(i-1), 2^i)ms，最后一桶包含更长的间隔
+///< [NOTE]:间隔取自CLOCK_MONOTONIC_COARSE，分辨率为时钟tick(通常1~4ms)，小于一个tick的间隔都落在第0桶，第0、1桶只能区分是否跨tick
+#define TASK_HEARTBEAT_BUCKETS 16
+
+/**
+ * @brief 任务计数
+ * 
+ * [NOTE]:由心跳写入，独占缓存行。任务自己的线程、周期和协程调度线程是单写者，用relaxed读写；
+ * 反应器和其他线程调用task_alive(tid)时可能有多个写者，用relaxed原子加。两者并发时计数可能略少，仅作统计
+ */
+struct alignas(64) TaskCounter
+{
+	std::atomic<uint64_t> heartbeats;							///< 心跳次数
+	std::atomic<uint64_t> heartbeat_hist[TASK_HEARTBEAT_BUCKETS]; ///< 心跳间隔直方图
+	std::atomic<uint64_t> overruns;								///< 周期任务超期次数
+};
+
+/**
+ * @brief 任务运行指标
+ * 
+ */
+struct TaskMetrics
+{
+	uint64_t tid;								  ///< 任务id
+	std::string task_name;						  ///< 任务名称
+	enum task_state state;						  ///< 任务状态
+	uint8_t timeout_times;						  ///< 超时次数
+	std::chrono::nanoseconds uptime;			  ///< 创建至今
+	std::chrono::nanoseconds cpu_time;			  ///< 线程CPU时间
+	std::chrono::nanoseconds wait_time;			  ///< 处于e_task_wait的时间
+	uint64_t voluntary_switches;				  ///< 主动上下文切换次数
+	uint64_t involuntary_switches;				  ///< 被动上下文切换次数
+	uint64_t heartbeats;						  ///< 心跳次数
+	uint64_t heartbeat_hist[TASK_HEARTBEAT_BUCKETS]; ///< 心跳间隔直方图
+	uint64_t overruns;							  ///< 周期任务超期次数
+};
+
+/**
+ * @brief 任务管理检测统计
+ * 
  */
-struct TaskState
+struct TaskManageStat
 {
-	time_t create_time;		 ///< 创建时间
-	time_t last_update_time; ///< 上次更新时间
-	uint8_t timeout_times;   ///< 超时次数
-	enum task_state state;   ///< 线程状态
+	uint64_t ticks;					 ///< 检测次数
+	std::chrono::nanoseconds total;	 ///< 累计耗时
+	std::chrono::nanoseconds max;	 ///< 单次最大耗时
 };
 
 /**
@@ -114,17 +203,171 @@ struct TaskState
  */
 struct TaskDesc
 {
-	uint64_t tid;					   ///< 任务id
+	std::atomic<uint64_t> tid;		   ///< 任务id
+	std::atomic<uint32_t> slot;		   ///< 任务表位置，在分片锁内写，其他路径无锁读判断是否已移除
+	std::atomic<uint32_t> shard;	   ///< 发布所在的分片，由tid决定
+	uint32_t home;					   ///< 描述符池所在的分片，创建后不变
+	std::atomic<uint32_t> gen;		   ///< 复用代数
 	TaskRegisterInfo reg_info;		   ///< 任务属性
 	TaskState task_state;			   ///< 任务状态
+	TaskCounter counter;			   ///< 任务计数
 	TaskCall calls;					   ///< 任务调用
 	std::mutex mtx;					   ///< 任务锁
-	std::condition_variable condition; ///< 任务同步
+	TaskParker parker;				   ///< 暂停挂起与唤醒
+	std::stop_source stop;			   ///< 停止请求，任务结束或超时时请求；任务调用不接收令牌时在首次取令牌时创建，在任务锁内写
+	std::atomic<bool> quited;		   ///< 线程已退出，由线程退出通知设置
+	std::condition_variable quit_cond; ///< 线程退出同步
+	std::atomic<int> ktid;			   ///< 内核线程号，线程启动后设置
+	std::atomic<task_time_t> wait_start;			///< 进入等待的时间
+	std::atomic<task_clock::duration> wait_time;	///< 累计等待时间，不含当前等待
+	enum task_exec exec;			   ///< 执行方式，非独立线程的任务没有线程资源
+};
+
+/**
+ * @brief 任务引用，代数用于检测描述符复用
+ * 
+ */
+struct TaskRef
+{
+	TaskDesc *task; ///< 任务描述
+	uint32_t gen;	///< 引用时的代数
+};
+
+/**
+ * @brief 当前任务
+ * 
+ * 任务开始执行时在线程内记录任务描述，之后的查询只访问描述符，不查任务表，不产生系统调用。
+ * 线程任务在任务线程上有效，周期任务和协程任务在每次执行期间有效，只能在当前线程使用。
+ * 
+ */
+class TaskSelf
+{
+public:
+	TaskSelf() noexcept : ref_{nullptr, 0}, tid_(INVALID_TASK_ID) {}
+
+public:
+	// 当前线程是否在执行受管理的任务
+	bool valid(void) const noexcept { return nullptr != ref_.task; }
+
+	// 任务id
+	uint64_t tid(void) const noexcept { return tid_; }
+
+	// 任务名称
+	const std::string &name(void) const noexcept { return name_; }
+
+	// 任务状态，任务已被清理时为e_task_stop
+	enum task_state state(void) const noexcept
+	{
+		if (!owned()) return e_task_stop;
+
+		return ref_.task->task_state.state.load(std::memory_order_acquire);
+	}
+
+	// 任务存活检测并心跳，同Task::task_alive，线程任务暂停时阻塞直到继续
+	bool alive(void);
+
+	// 停止令牌，不在任务中执行时为空令牌
+	const TaskStopToken &stop_token(void)
+	{
+		if (!stop_.stop_possible() && valid()) load_stop();
+
+		return stop_;
+	}
+
+	// 是否已请求停止，取得令牌后只是一次原子读
+	bool stop_requested(void) { return stop_token().stop_requested(); }
+
+private:
+	friend class Task;
+	friend class TaskSelfScope;
+
+	// 描述符仍属于本任务
+	bool owned(void) const noexcept
+	{
+		return valid() && ref_.gen == ref_.task->gen.load(std::memory_order_acquire) && tid_ == ref_.task->tid;
+	}
+
+	// 取任务的停止令牌，任务还没有停止状态时创建
+	void load_stop(void);
+
+private:
+	TaskRef ref_;		///< 任务引用
+	uint64_t tid_;		///< 任务id
+	std::string name_;	///< 任务名称
+	TaskStopToken stop_; ///< 停止令牌
+};
+
+/**
+ * @brief 切换当前线程执行的任务，析构时恢复，用于周期任务和协程任务
+ * 
+ */
+class TaskSelfScope
+{
+public:
+	TaskSelfScope(const TaskRef &ref, const uint64_t &tid);
+	~TaskSelfScope();
+
+	TaskSelfScope(const TaskSelfScope &) = delete;
+	TaskSelfScope &operator=(const TaskSelfScope &) = delete;
+
+private:
+	TaskSelf prev_; ///< 之前的任务
 };
 
 // 异常任务外部处理回调接口
 using abnormal_task_do = void (*)(const struct TaskExceptInfo &);
 
+class TaskShards;
+struct TaskShard;
+class TaskPeriodic;
+class TaskCoScheduler;
+struct TaskCoContext;
+
+template <typename T>
+class co_task;
+
+/**
+ * @brief 任务结果类型，协程任务为co_return的类型
+ * 
+ * @tparam T : 任务调用返回值类型
+ */
+template <typename T>
+struct task_result
+{
+	using type = T;
+	static constexpr bool coroutine = false;
+};
+
+template <typename T>
+struct task_result<co_task<T>>
+{
+	using type = T;
+	static constexpr bool coroutine = true;
+};
+
+// 任务调用第一个参数可以接收TaskStopToken时，传入任务的停止令牌
+template <typename F, typename... Args>
+inline constexpr bool task_takes_stop = std::is_invocable_v<F, TaskStopToken, Args...>;
+
+template <bool Stop, typename F, typename... Args>
+struct task_call_ret
+{
+	using type = callable_ret_type<F, Args...>;
+};
+
+template <typename F, typename... Args>
+struct task_call_ret<true, F, Args...>
+{
+	using type = callable_ret_type<F, TaskStopToken, Args...>;
+};
+
+// 任务调用返回值类型，包含停止令牌参数
+template <typename F, typename... Args>
+using task_call_ret_type = typename task_call_ret<task_takes_stop<F, Args...>, F, Args...>::type;
+
+template <typename F, typename... Args>
+using task_result_type = typename task_result<task_call_ret_type<F, Args...>>::type;
+
 class Task
 {
 	// 不允许外部实例化
@@ -135,24 +378,130 @@ public:
 	~Task();
 
 public:
-	// 创建任务
+	// 当前任务，不查表
+	static TaskSelf &self(void) noexcept;
+
+	// 创建任务，f第一个参数为TaskStopToken时传入停止令牌，f返回co_task时为协程任务(需包含task_coroutine.h)
 	template <typename F, typename... Args>
-	static TaskKey<callable_ret_type<F, Args...>>
+	static TaskKey<task_result_type<F, Args...>>
 	register_task(const TaskRegisterInfo &reg_info, F &&f, Args &&... args)
 	{
-		TaskKey<callable_ret_type<F, Args...>> ret;
+		using R = task_call_ret_type<F, Args...>;
+
+		if constexpr (task_result<R>::coroutine)
+		{
+			static_assert(!task_takes_stop<F, Args...>, "coroutine task use Task::self().stop_token()");
+
+			return register_coroutine(reg_info, std::forward<F>(f), std::forward<Args>(args)...);
+		}
+		else
+		{
+			TaskKey<R> ret;
+			TaskFunction<void()> task;
+			// 不接收令牌的任务不申请停止状态，Task::self().stop_token()首次调用时再创建
+			std::stop_source stop(std::nostopstate);
+
+			// 可调用对象和返回值打包在同一块内存
+			if constexpr (task_takes_stop<F, Args...>)
+			{
+				stop = std::stop_source();
+				ret.fut = make_task_packaged(task, std::forward<F>(f), TaskStopToken(stop.get_token()), std::forward<Args>(args)...);
+			}
+			else
+			{
+				ret.fut = make_task_packaged(task, std::forward<F>(f), std::forward<Args>(args)...);
+			}
+
+			// 添加任务
+			if (!task_ptr()->add_task(ret.tid, ret.policy, reg_info, std::move(task), stop))
+			{
+				throw std::invalid_argument("add task create failed");
+			}
+
+			return ret;
+		}
+	}
+
+	/**
+	 * @brief 批量创建任务
+	 * 
+	 * 一次加锁申请所有描述符，锁外并行创建线程，再一次加锁发布，适合启动时创建大量工作任务。
+	 * 创建线程期间不持有任务表锁，线程缓存锁也只在登记线程时持有，各段的pthread_create可以同时进行。
+	 * 第i个任务执行f(i)，f第一个参数为TaskStopToken时执行f(stop, i)，f需可复制，不支持协程任务。
+	 * 个别线程创建失败时对应任务的tid为INVALID_TASK_ID，返回值为broken_promise，其余任务正常发布。
+	 * 
+	 * @param reg_infos : 注册信息，每个任务一个
+	 * @param f : 任务调用，参数为任务序号
+	 * @return std::vector<TaskKey> : 与reg_infos一一对应
+	 * @throw std::invalid_argument : 超出任务数量上限
+	 */
+	template <typename F>
+	static std::vector<TaskKey<task_call_ret_type<F, size_t>>>
+	register_tasks(std::span<const TaskRegisterInfo> reg_infos, F &&f)
+	{
+		using R = task_call_ret_type<F, size_t>;
+
+		static_assert(!task_result<R>::coroutine, "register_tasks not support coroutine task");
+
+		std::vector<TaskKey<R>> ret(reg_infos.size());
+		std::vector<TaskFunction<void()>> tasks(reg_infos.size());
+		std::vector<std::stop_source> stops(reg_infos.size(), std::stop_source(std::nostopstate));
+		std::vector<uint64_t> tids(reg_infos.size(), INVALID_TASK_ID);
+		std::vector<enum task_sched_policy> policies(reg_infos.size(), e_task_sched_inherit);
+
+		for (size_t i = 0; i < reg_infos.size(); i++)
+		{
+			if constexpr (task_takes_stop<F, size_t>)
+			{
+				stops[i] = std::stop_source();
+				ret[i].fut = make_task_packaged(tasks[i], f, TaskStopToken(stops[i].get_token()), i);
+			}
+			else
+			{
+				ret[i].fut = make_task_packaged(tasks[i], f, i);
+			}
+		}
+
+		if (!task_ptr()->add_tasks(reg_infos, tasks, stops, tids, policies))
+		{
+			throw std::invalid_argument("add tasks create failed");
+		}
+
+		for (size_t i = 0; i < reg_infos.size(); i++)
+		{
+			ret[i].tid = tids[i];
+			ret[i].policy = policies[i];
+		}
 
-		// 可调用对象封装为void(void)
-		auto task = std::make_shared<std::packaged_task<callable_ret_type<F, Args...>()>>(
-			std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+		return ret;
+	}
 
-		// 获取未来值对象
-		ret.fut = task->get_future();
+	/**
+	 * @brief 创建周期任务
+	 * 
+	 * 由框架按绝对截止时间每个周期调用一次f，每次执行完成自动心跳，执行超过周期记录超期次数。
+	 * 所有周期任务共用一个定时线程，reg_info.task_attr中只有任务名称有效。
+	 * 与普通任务一样需要task_run启动，task_exit结束，返回值在任务结束时就绪，f抛出异常时任务结束并按异常处理。
+	 * 心跳只在每次执行完成后产生，两次心跳间隔约为一个周期，reg_info.alive_time不大于period时会被误判超时，注册失败；
+	 * 考虑执行耗时和时钟精度，alive_time建议至少为两个周期。
+	 * 
+	 * @param reg_info : 注册信息，alive_time需大于period
+	 * @param period : 周期
+	 * @param f : 周期调用
+	 * @param args : 参数
+	 * @return TaskKey<void> : 任务
+	 */
+	template <typename F, typename... Args>
+	static TaskKey<void>
+	register_periodic(const TaskRegisterInfo &reg_info, const std::chrono::nanoseconds &period, F &&f, Args &&... args)
+	{
+		TaskKey<void> ret;
+		auto fn = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
 
-		// 添加任务
-		if (!task_ptr()->add_task(ret.tid, reg_info, [task]() { (*task)(); }))
+		// 忽略返回值，每个周期重复调用
+		if (!task_ptr()->add_periodic(ret, reg_info, period, [fn = std::move(fn)]() mutable { fn(); }))
 		{
-			throw std::invalid_argument("add task create failed");
+			throw std::invalid_argument("add periodic task failed");
 		}
 
 		return ret;
@@ -163,12 +512,10 @@ public:
 	static future_callback_type<F, Args...>
 	add_task_except_action(const uint64_t &tid, F &&f, Args &&... args)
 	{
-		auto task = std::make_shared<std::packaged_task<callable_ret_type<F, Args...>()>>(
-			std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+		TaskFunction<void()> task;
+		future_callback_type<F, Args...> ret = make_task_packaged(task, std::forward<F>(f), std::forward<Args>(args)...);
 
-		future_callback_type<F, Args...> ret = task->get_future();
-
-		if (!task_ptr()->add_e_action(tid, [task]() { (*task)(); }))
+		if (!task_ptr()->add_e_action(tid, std::move(task)))
 		{
 			throw std::invalid_argument("add task except action failed");
 		}
@@ -181,12 +528,10 @@ public:
 	static future_callback_type<F, Args...>
 	add_task_timeout_action(const uint64_t &tid, F &&f, Args &&... args)
 	{
-		auto task = std::make_shared<std::packaged_task<callable_ret_type<F, Args...>()>>(
-			std::bind(std::forward<F>(f), std::forward<Args>(args)...));
-
-		future_callback_type<F, Args...> ret = task->get_future();
+		TaskFunction<void()> task;
+		future_callback_type<F, Args...> ret = make_task_packaged(task, std::forward<F>(f), std::forward<Args>(args)...);
 
-		if (!task_ptr()->add_timeout_action(tid, [task]() { (*task)(); }))
+		if (!task_ptr()->add_timeout_action(tid, std::move(task)))
 		{
 			throw std::invalid_argument("add task timeout action failed");
 		}
@@ -199,12 +544,10 @@ public:
 	static future_callback_type<F, Args...>
 	add_task_exit_action(const uint64_t &tid, F &&f, Args &&... args)
 	{
-		auto task = std::make_shared<std::packaged_task<callable_ret_type<F, Args...>()>>(
-			std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+		TaskFunction<void()> task;
+		future_callback_type<F, Args...> ret = make_task_packaged(task, std::forward<F>(f), std::forward<Args>(args)...);
 
-		future_callback_type<F, Args...> ret = task->get_future();
-
-		if (!task_ptr()->add_clean(tid, [task]() { (*task)(); }))
+		if (!task_ptr()->add_clean(tid, std::move(task)))
 		{
 			throw std::invalid_argument("add task exit action failed");
 		}
@@ -214,12 +557,16 @@ public:
 
 	// 启动任务
 	static void task_run(const uint64_t &tid);
-	// 任务结束
-	static void task_exit(const uint64_t &tid);
+	// 任务结束，先请求停止，超时未退出则强制结束
+	static void task_exit(const uint64_t &tid, const std::chrono::milliseconds &timeout = TASK_MS(1500));
+	// 结束所有任务，并行等待
+	static void task_exit_all(const std::chrono::milliseconds &timeout = TASK_MS(1500));
 
 	// 任务心跳
 	static bool task_alive(const uint64_t &tid);
-	// 任务是否存活
+	// 任务进度心跳，不阻塞，暂停中不计心跳，任务已结束返回false
+	static bool task_progress(const uint64_t &tid);
+	// 任务是否存活，只读取任务状态，不产生系统调用；任务内检测退出请使用Task::self().stop_requested()
 	static bool is_task_alive(const uint64_t &tid);
 	// 获取任务状态
 	static enum task_state task_state(const uint64_t &tid);
@@ -228,10 +575,28 @@ public:
 	static void task_wait(const uint64_t &tid);
 	// 任务继续
 	static void task_continue(const uint64_t &tid);
+	// 批量暂停任务，返回状态切换的任务数量
+	static size_t task_wait(std::span<const uint64_t> tids);
+	// 批量继续任务，返回状态切换的任务数量
+	static size_t task_continue(std::span<const uint64_t> tids);
+
+	// 设置任务CPU亲和性
+	static bool set_affinity(const uint64_t &tid, const cpu_set_t &affinity);
+
+	// 获取任务运行指标
+	static bool task_metrics(const uint64_t &tid, TaskMetrics &metrics);
+	// 获取所有任务运行指标
+	static std::vector<TaskMetrics> task_metrics(void);
+	// 获取所有任务id，不阻塞任务创建和退出
+	static std::vector<uint64_t> task_list(void);
+	// 获取任务管理检测统计
+	static TaskManageStat manage_stat(void);
 
 public:
 	// 初始化任务组件
-	static void task_init(const uint32_t &max_tasks = 128, abnormal_task_do except_fun = nullptr);
+	static void task_init(const uint32_t &max_tasks = 128,
+						  abnormal_task_do except_fun = nullptr,
+						  const std::chrono::milliseconds &manage_period = TASK_SEC(1));
 
 private:
 	// 单例模式。获取任务组件，不允许外部获取
@@ -239,36 +604,75 @@ private:
 
 private:
 	friend class TaskAutoManage;
+	friend class TaskPeriodic;
+	friend class TaskCoScheduler;
+	friend class TaskSelf;
 	// 开启任务管理
 	friend TaskKey<int> task_auto_manage(Task *task);
+	// 任务运行
+	friend void *_task_run(TaskDesc *_task);
 
 public:
 	// 等待任务创建完成
 	void wait(void);
 	// 查找任务
-	std::shared_ptr<TaskDesc> search_task(const uint64_t &tid) noexcept;
+	TaskDesc *search_task(const uint64_t &tid) noexcept;
 
 private:
 	// 添加任务
-	bool add_task(uint64_t &tid, const TaskRegisterInfo &reg_info, const std::function<void()> &task);
+	bool add_task(uint64_t &tid, enum task_sched_policy &policy, const TaskRegisterInfo &reg_info, TaskFunction<void()> &&task,
+				  const std::stop_source &stop);
+	// 批量添加任务
+	bool add_tasks(std::span<const TaskRegisterInfo> reg_infos, std::vector<TaskFunction<void()>> &tasks,
+				   const std::vector<std::stop_source> &stops, std::vector<uint64_t> &tids, std::vector<enum task_sched_policy> &policies);
+	// 添加周期任务
+	bool add_periodic(TaskKey<void> &key, const TaskRegisterInfo &reg_info, const std::chrono::nanoseconds &period, TaskFunction<void()> &&fn);
+	// 创建协程任务，定义在task_coroutine.h
+	template <typename F, typename... Args>
+	static TaskKey<task_result_type<F, Args...>>
+	register_coroutine(const TaskRegisterInfo &reg_info, F &&f, Args &&... args);
+	// 添加协程任务
+	bool add_coroutine(uint64_t &tid, const TaskRegisterInfo &reg_info, const std::shared_ptr<TaskCoContext> &ctx);
 	// 添加任务异常处理
-	bool add_e_action(const uint64_t &tid, const std::function<void()> &e_action);
+	bool add_e_action(const uint64_t &tid, TaskFunction<void()> &&e_action);
 	// 超时处理
-	bool add_timeout_action(const uint64_t &tid, const std::function<void()> &timeout);
+	bool add_timeout_action(const uint64_t &tid, TaskFunction<void()> &&timeout);
 	// 添加任务退出处理
-	bool add_clean(const uint64_t &tid, const std::function<void()> &clean);
-	// 删除任务
-	void del_task(const uint64_t &tid);
+	bool add_clean(const uint64_t &tid, TaskFunction<void()> &&clean);
+	// 发布任务并交给任务管理，需持有分片锁
+	void publish(TaskShard &shard, TaskDesc *task, const uint64_t &tid);
+	// 解除相同id的旧任务索引，需持有分片锁
+	void del_task(TaskShard &shard, const uint64_t &tid);
+	// 心跳计数，任务状态需为存活，shared为可能有多个线程同时心跳
+	static void heartbeat(TaskDesc *task, const bool &shared) noexcept;
+	// 存活检测并心跳，暂停时等待继续
+	static bool wait_alive(TaskDesc *task, const uint64_t &tid);
+	// 暂停，不加锁
+	static bool pause(TaskDesc *task, const uint64_t &tid, const task_time_t &_now) noexcept;
+	// 继续并唤醒，不加锁
+	static bool resume(TaskDesc *task, const uint64_t &tid, const task_time_t &_now);
+	// 任务线程退出通知
+	static void task_quit(const TaskRef &ref);
+	// 采集任务运行指标，需持有任务锁
+	static bool collect_metrics(TaskDesc *task, TaskMetrics &metrics);
+	// 结束任务，先全部通知，再等待到同一截止时间
+	void exit_tasks(const std::vector<TaskDesc *> &tasks, const std::chrono::milliseconds &timeout);
 
 private:
 	static bool stop;					///< 停止标记
 	static uint32_t max_tasks;			///< 任务数量
 	static abnormal_task_do except_fun; ///< 异常报告
+	static std::atomic<std::chrono::milliseconds> manage_period; ///< 任务管理检测周期
 
 private:
-	std::mutex mtx_;							   ///< 操作锁
-	std::vector<std::shared_ptr<TaskDesc>> tasks_; ///< 任务队列
-	std::future<int> manage_exit_fut_;			   ///< 管理任务退出码
+	std::mutex mtx_;					///< 调度线程启动锁
+	std::unique_ptr<TaskShards> shards_; ///< 分片任务表
+	std::atomic<uint64_t> manage_ticks_;	///< 任务管理检测次数
+	std::atomic<uint64_t> manage_total_;	///< 任务管理累计耗时(ns)
+	std::atomic<uint64_t> manage_max_;		///< 任务管理单次最大耗时(ns)
+	TaskFuture<int> manage_exit_fut_;	///< 管理任务退出码
+	std::unique_ptr<TaskPeriodic> periodic_; ///< 周期任务调度，首个周期任务创建时启动
+	std::unique_ptr<TaskCoScheduler> co_;	///< 协程任务调度，首个协程任务创建时启动
 };
 
 const char *get_task_version(void);
@@ -9,7 +9,10 @@
  * 
  */
 
-#include <algorithm>
+#include <thread>
+#include <chrono>
+#include "posix_thread.h"
+#include "task_table.h"
 #include "task_auto_manage.h"
 
 namespace wotsen
@@ -18,19 +21,16 @@ extern task_dbg_cb __dbg;
 
 // 任务超时最大次数
 static const int MAX_CNT_TASK_TIMEOUT = 3;
-// 异常时间差s
-static const time_t MAX_ERROR_TIME = 60;
+
+TaskAutoManage::TaskAutoManage(Task *task) : task_(task), system_reboot_(false)
+{
+	for (size_t i = 0; i < task_->shards_->count(); i++) shards_.emplace_back(new TaskShardManage(i));
+}
 
 void TaskAutoManage::task_update(void) noexcept
 {
-	// 清理死亡任务
-	clean_dead();
-	// 异常标记
-	dead_mark();
-    // 超时标记
-    timeout_mark();
-	// 异常处理
-	except_do();
+	// 逐个分片检测，分片之间不共享检测状态
+	for (auto &item : shards_) shard_update(*item);
 
 	if (system_reboot_)
 	{
@@ -38,112 +38,153 @@ void TaskAutoManage::task_update(void) noexcept
 	}
 }
 
-void TaskAutoManage::task_correction_time(void) noexcept
+void TaskAutoManage::shard_update(TaskShardManage &shard) noexcept
 {
-	static time_t last_time = now();
-	time_t now_t = now();
-
-	// 时间向前跳变和时间向后跳变超过一分钟，重置任务时间
-    if (now_t < last_time || (now_t - last_time) > MAX_ERROR_TIME)
 	{
-		std::unique_lock<std::mutex> lock(task_->mtx_);
-
-		for (auto item : task_->tasks_)
-		{
-			std::unique_lock<std::mutex> i_lock(item->mtx);
-
-			// 重置时间和次数
-			item->task_state.last_update_time = now_t;
-			item->task_state.timeout_times = 0;
-		}
+		TaskShard &_shard = task_->shards_->at(shard.index);
+		std::unique_lock<std::mutex> lock(_shard.mtx);
+
+		// 取出新加入和已退出的任务
+		shard.joined.insert(shard.joined.end(), _shard.joined.begin(), _shard.joined.end());
+		shard.quited.insert(shard.quited.end(), _shard.quited.begin(), _shard.quited.end());
+		_shard.joined.clear();
+		_shard.quited.clear();
 	}
 
-	last_time = now_t;
+	// 清理死亡任务
+	clean_dead(shard);
+	// 接管新任务
+	task_join(shard);
+	// 异常标记
+	dead_mark(shard);
+	// 超时标记
+	timeout_mark(shard);
+	// 异常处理
+	except_do(shard);
 }
 
-bool TaskAutoManage::task_filter(std::shared_ptr<TaskDesc> &task)
+bool TaskAutoManage::task_valid(const TaskRef &ref) const noexcept
 {
-	// 非存活任务或任务已经销毁则过滤掉
-	return INVALID_TASK_ID == task->tid
-			|| e_task_alive != task->task_state.state
-			|| !is_task_alive(task->tid);
+	// 描述符已回收复用
+	return ref.gen == ref.task->gen.load(std::memory_order_acquire);
 }
 
-void TaskAutoManage::dead_mark(void)
+void TaskAutoManage::task_join(TaskShardManage &shard)
 {
-	std::unique_lock<std::mutex> lock(task_->mtx_);
+	for (auto &item : shard.joined)
+	{
+		if (!task_valid(item)) continue;
+
+		// 按注册时的存活时间设置首次检测时间
+		shard.wheel.add(item.task->task_state.create_time + item.task->reg_info.alive_time, item);
+	}
 
-	for (auto item : task_->tasks_)
+	shard.joined.clear();
+}
+
+void TaskAutoManage::dead_mark(TaskShardManage &shard)
+{
+	for (auto &item : shard.quited)
 	{
-		// 无效任务及退出任务
-		if (INVALID_TASK_ID == item->tid ||
-			(e_task_dead != item->task_state.state
-			&& e_task_stop != item->task_state.state
-			&& !is_task_alive(item->tid)))
-		{
-			std::unique_lock<std::mutex> i_lock(item->mtx);
-			item->task_state.state = e_task_dead;
-		}
+		if (!task_valid(item)) continue;
+
+		std::unique_lock<std::mutex> i_lock(item.task->mtx);
+
+		enum task_state state = item.task->task_state.state;
+
+		// 主动退出的任务由task_exit清理，超时任务由异常处理标记
+		if (e_task_stop == state || e_task_dead == state || e_task_timeout == state) continue;
+
+		item.task->task_state.state = e_task_dead;
+		shard.except.push_back(item);
 	}
+
+	shard.quited.clear();
 }
 
-void TaskAutoManage::task_dead_handler(std::shared_ptr<TaskDesc> &task)
+void TaskAutoManage::task_dead_handler(TaskDesc *task, TaskFunction<void()> &e_action)
 {
 	switch (task->reg_info.e_action)
 	{
 	case e_task_ignore:
 		break;
 	case e_task_reboot_system:
-		if (task->calls.e_action) task->calls.e_action();
+		if (e_action) e_action();
 		system_reboot_ = true;
 		break;
 	case e_task_default:
 	default:
-		if (task->calls.e_action) task->calls.e_action();
+		if (e_action) e_action();
 		break;
 	}
 }
 
-void TaskAutoManage::except_do(void)
+void TaskAutoManage::except_do(TaskShardManage &shard)
 {
 	TaskExceptInfo ex_info;
+	std::vector<TaskRef> excepts;
 
-	for (auto item : task_->tasks_)
+	// 取出待处理任务
+	excepts.swap(shard.except);
+
+	for (auto &item : excepts)
 	{
-		std::unique_lock<std::mutex> lock(item->mtx);
+		if (!task_valid(item)) continue;
+
+		TaskFunction<void()> action;
+		std::unique_lock<std::mutex> lock(item.task->mtx);
 
-		switch (item->task_state.state)
+		switch (item.task->task_state.state)
 		{
 		case e_task_timeout:
-			ex_info.tid = item->tid;
-			ex_info.task_name =	item->reg_info.task_attr.task_name;
+		{
+			ex_info.tid = item.task->tid;
+			ex_info.task_name =	item.task->reg_info.task_attr.task_name;
 			ex_info.reason = "timeout";
 
+			// 锁内取出超时接口，锁外执行期间task_exit回收描述符也不会析构它
+			action = std::move(item.task->calls.timout_action);
+
 			lock.unlock();
 			
 			// 通知任务异常信息
 			if (Task::except_fun) Task::except_fun(ex_info);
 
 			// 执行超时接口
-			if (item->calls.timout_action) item->calls.timout_action();
+			if (action) action();
+
+			std::stop_source stop(std::nostopstate);
 
 			lock.lock();
 			// 下个周期做异常处理
-			item->task_state.state = e_task_dead;
+			item.task->task_state.state = e_task_dead;
+			// 停止状态可能由任务线程在锁内延迟创建，锁内取出，之后创建的会看到dead状态自行请求停止
+			stop = item.task->stop;
 			lock.unlock();
 
+			// 超时的任务不再被检测，请求停止让其尽快返回
+			stop.request_stop();
+
+			shard.dead.push_back(item);
+
 			break;
+		}
 
 		case e_task_dead:
-			lock.unlock();
-
-			ex_info.tid = item->tid;
-			ex_info.task_name =	item->reg_info.task_attr.task_name;
+			ex_info.tid = item.task->tid;
+			ex_info.task_name =	item.task->reg_info.task_attr.task_name;
 			ex_info.reason = "except dead";
 
+			// 同超时接口，锁内取出异常接口
+			action = std::move(item.task->calls.e_action);
+
+			lock.unlock();
+
 			if (Task::except_fun) Task::except_fun(ex_info);
 
-			task_dead_handler(item);
+			task_dead_handler(item.task, action);
+
+			shard.dead.push_back(item);
 
 			break;
 
@@ -154,49 +195,89 @@ void TaskAutoManage::except_do(void)
 	}
 }
 
-void TaskAutoManage::timeout_mark(void) noexcept
+void TaskAutoManage::timeout_mark(TaskShardManage &shard) noexcept
 {
-	// 系统时间异常矫正
-    task_correction_time();
+	task_time_t now_t = now();
+	TimerWheel<TaskRef> &wheel = shard.wheel;
 
-	std::unique_lock<std::mutex> lock(task_->mtx_);
-	
-	for (auto item : task_->tasks_)
-	{
-		if (task_filter(item)) continue;
+	// 只处理检测时间已到的任务，心跳只更新时间，在这里延迟重新计算检测时间
+	wheel.advance(now_t, [&](TaskRef &item) {
+		if (!task_valid(item)) return;
+
+		TaskDesc *task = item.task;
+
+		switch (task->task_state.state.load(std::memory_order_acquire))
+		{
+		case e_task_alive:
+			break;
+
+		case e_task_wait:
+			// 暂停的任务不检测，一个存活周期后再看
+			task->task_state.timeout_times = 0;
+			wheel.add(now_t + task->reg_info.alive_time, item);
+			return;
 
-		std::unique_lock<std::mutex> i_lock(item->mtx);
+		default:
+			// 其他状态不再检测
+			return;
+		}
+
+		// 心跳无锁更新，这里只读取时间，不使用任务锁
+		task_time_t last = task->task_state.last_update_time.load(std::memory_order_relaxed);
 
 		// 超时判断
-		if (now() - item->task_state.last_update_time > item->reg_info.alive_time)
+		if (now_t - last > task->reg_info.alive_time)
 		{
-			task_dbg("task [%s][%ld] timeout\n", item->reg_info.task_attr.task_name.c_str(), item->tid);
+			task_dbg("task [%s][%ld] timeout\n", task->reg_info.task_attr.task_name.c_str(), task->tid.load());
+
+			// 线程没有经过退出通知就消失时不会再心跳，只在超时时确认内核线程，按线程退出处理
+			if (e_task_exec_thread == task->exec && !task->quited.load(std::memory_order_acquire)
+				&& task->ktid.load(std::memory_order_relaxed) && !thread_kernel_alive(task->ktid.load(std::memory_order_relaxed)))
+			{
+				task_dbg("task [%ld] thread lost\n", task->tid.load());
+				Task::task_quit(item);
+				return;
+			}
 
-			if (item->task_state.timeout_times++ >= MAX_CNT_TASK_TIMEOUT)
+			if (task->task_state.timeout_times++ >= MAX_CNT_TASK_TIMEOUT)
 			{
-				// 先置超时，下次进行处理
-				item->task_state.state = e_task_timeout;
+				// 先置超时，下次进行处理；期间任务可能被暂停或结束
+				enum task_state expect = e_task_alive;
+
+				if (task->task_state.state.compare_exchange_strong(expect, e_task_timeout))
+				{
+					shard.except.push_back(item);
+					return;
+				}
 			}
+
+			// 下个检测周期再判断
+			wheel.add(now_t + Task::manage_period.load(), item);
 		}
 		else
 		{
-			item->task_state.timeout_times = 0;
+			task->task_state.timeout_times = 0;
+			wheel.add(last + task->reg_info.alive_time + TASK_MS(1), item);
 		}
-
-		i_lock.unlock();
-	}
+	});
 }
 
-void TaskAutoManage::clean_dead(void)
+void TaskAutoManage::clean_dead(TaskShardManage &shard)
 {
-	std::unique_lock<std::mutex> lock(task_->mtx_);
-
-	task_->tasks_.erase(std::remove_if(task_->tasks_.begin(),
-										task_->tasks_.end(),
-										[](auto item) -> bool {
-											return e_task_dead == item->task_state.state;
-										}),
-						task_->tasks_.end());
+	size_t n = 0;
+
+	// 期间可能已被task_exit移除或重新标记，移除时在分片锁内再次校验
+	for (auto &item : shard.dead)
+	{
+		if (task_valid(item) && e_task_dead == item.task->task_state.state) shard.dead[n++] = item;
+	}
+
+	shard.dead.resize(n);
+
+	// 同一分片的任务一次加锁移除
+	task_->shards_->erase(shard.index, shard.dead);
+
+	shard.dead.clear();
 }
 
 TaskKey<int> task_auto_manage(Task *task)
@@ -209,11 +290,29 @@ TaskKey<int> task_auto_manage(Task *task)
 	TaskKey<int> ret = new_task(attr, [task](void) -> int {
 		std::shared_ptr<TaskAutoManage> manage(new TaskAutoManage(task));
 
+		// 按绝对时间推进检测周期，避免累积漂移
+		auto next = std::chrono::steady_clock::now();
+
 		// 检测任务组件退出
 		for (; !Task::stop ;)
 		{
-			std::this_thread::sleep_for(std::chrono::seconds(1));
+			next += Task::manage_period.load();
+			std::this_thread::sleep_until(next);
+
+			auto start = std::chrono::steady_clock::now();
+
 			manage->task_update();
+
+			// 检测耗时统计，只有任务管理线程写入
+			uint64_t cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+			task->manage_ticks_.store(task->manage_ticks_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			task->manage_total_.store(task->manage_total_.load(std::memory_order_relaxed) + cost, std::memory_order_relaxed);
+
+			if (cost > task->manage_max_.load(std::memory_order_relaxed)) task->manage_max_.store(cost, std::memory_order_relaxed);
+
+			// 处理耗时超过周期则从当前时间重新计算
+			if (next < std::chrono::steady_clock::now()) next = std::chrono::steady_clock::now();
 		}
 
 		task_dbg("task auto manage exit.\n");
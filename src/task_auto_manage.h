@@ -12,22 +12,40 @@
 #pragma once
 
 #include "task.h"
+#include "task_timer_wheel.h"
 
 namespace wotsen
 {
 
 #define task_dbg(fmt, args...) __dbg ? __dbg("[%s][%d][%s]" fmt, __FILE__, __LINE__, __PRETTY_FUNCTION__, ##args) : (void)0
 
-static inline time_t now(void)
+static inline task_time_t now(void)
 {
-	return time(nullptr);
+	return task_clock::now();
 }
 
+/**
+ * @brief 分片检测状态，与任务表分片一一对应
+ * 
+ * 任务只在所在分片内检测和清理，一个分片的检测只访问该分片的锁和时间轮。
+ */
+struct TaskShardManage
+{
+	size_t index;					///< 分片编号
+	TimerWheel<TaskRef> wheel;		///< 超时检测时间轮
+	std::vector<TaskRef> joined;	///< 新加入任务
+	std::vector<TaskRef> quited;	///< 线程已退出任务
+	std::vector<TaskRef> except;	///< 待异常处理任务
+	std::vector<TaskRef> dead;		///< 待清理任务
+
+	TaskShardManage(const size_t &i) : index(i), wheel(now(), TASK_MS(1)) {}
+};
+
 // 任务自动管理
 class TaskAutoManage
 {
 public:
-	TaskAutoManage(Task *task) : task_(task), system_reboot_(false) {}
+	TaskAutoManage(Task *task);
 	~TaskAutoManage() {}
 
 public:
@@ -35,27 +53,29 @@ public:
 	void task_update(void) noexcept;
 
 private:
-	// 任务时间矫正
-	void task_correction_time(void) noexcept;
-	// 异常任务过滤
-	bool task_filter(std::shared_ptr<TaskDesc> &task);
+	// 检测一个分片
+	void shard_update(TaskShardManage &shard) noexcept;
+	// 接管新任务
+	void task_join(TaskShardManage &shard);
+	// 引用是否有效
+	bool task_valid(const TaskRef &ref) const noexcept;
 
 	// 超时标记
-	void timeout_mark(void) noexcept;
+	void timeout_mark(TaskShardManage &shard) noexcept;
 	// 崩溃标记
-	void dead_mark(void);
+	void dead_mark(TaskShardManage &shard);
 	// 异常处理
-	void except_do(void);
+	void except_do(TaskShardManage &shard);
 	
 	// 任务崩溃处理
-	void task_dead_handler(std::shared_ptr<TaskDesc> &task);
+	void task_dead_handler(TaskDesc *task, TaskFunction<void()> &e_action);
 	// 清理崩溃任务
-	void clean_dead(void);
+	void clean_dead(TaskShardManage &shard);
 
 private:
-	Task *task_;			///< 任务
-	time_t last_time_;		///< 最新记录时间
-	bool system_reboot_;	///< 系统重启
+	Task *task_;											///< 任务
+	bool system_reboot_;									///< 系统重启
+	std::vector<std::unique_ptr<TaskShardManage>> shards_;	///< 各分片检测状态
 };
 
 TaskKey<int> task_auto_manage(Task *task);
@@ -0,0 +1,260 @@
+/**
+ * @file task_coroutine.cpp
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 协程任务
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include "task_coroutine.h"
+#include "task_auto_manage.h"
+
+namespace wotsen
+{
+extern task_dbg_cb __dbg;
+
+// 当前线程正在执行的协程任务
+static thread_local TaskCoContext *tls_co = nullptr;
+
+// 协程工作线程属性
+static TaskAttribute co_attr(void)
+{
+	TaskAttribute attr = TaskPool::default_attr();
+
+	attr.task_name = "task co";
+
+	return attr;
+}
+
+TaskCoScheduler::TaskCoScheduler()
+	: exit_(false), pool_(0, co_attr()), timer_(&pool_)
+{
+}
+
+TaskCoScheduler::~TaskCoScheduler()
+{
+	std::vector<std::shared_ptr<TaskCoContext>> tasks;
+
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		// 之后执行中的协程不再挂起，尽快结束
+		exit_ = true;
+
+		for (auto &item : tasks_) tasks.push_back(item.second);
+	}
+
+	// 挂起中的协程直接销毁，返回值置为broken_promise
+	for (auto &item : tasks) destroy(item->tid);
+
+	// 成员析构时先停止定时，再等待工作线程执行完剩余协程
+}
+
+TaskCoContext *TaskCoScheduler::current(void) noexcept
+{
+	return tls_co;
+}
+
+void TaskCoScheduler::add(const std::shared_ptr<TaskCoContext> &ctx)
+{
+	ctx->parked = ctx->root;
+
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	tasks_[ctx->tid] = ctx;
+}
+
+std::shared_ptr<TaskCoContext> TaskCoScheduler::find(const uint64_t &tid)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	auto it = tasks_.find(tid);
+
+	return tasks_.end() == it ? nullptr : it->second;
+}
+
+void TaskCoScheduler::run(TaskCoContext *ctx, std::coroutine_handle<> h)
+{
+	TaskCoContext *prev = tls_co;
+	TaskSelfScope self(ctx->ref, ctx->tid);
+
+	tls_co = ctx;
+	h.resume();
+	tls_co = prev;
+}
+
+void TaskCoScheduler::resume(const std::shared_ptr<TaskCoContext> &ctx, std::coroutine_handle<> h)
+{
+	// 执行期间持有上下文，根协程结束后才释放
+	pool_.post([ctx, h]() { run(ctx.get(), h); });
+}
+
+void TaskCoScheduler::resume_parked(const uint64_t &tid)
+{
+	auto ctx = find(tid);
+
+	if (!ctx) return;
+
+	std::coroutine_handle<> h;
+
+	{
+		std::unique_lock<std::mutex> lock(ctx->mtx);
+
+		std::swap(h, ctx->parked);
+	}
+
+	if (h) resume(ctx, h);
+}
+
+void TaskCoScheduler::stop(const uint64_t &tid)
+{
+	auto ctx = find(tid);
+
+	if (!ctx) return;
+
+	std::coroutine_handle<> parked;
+	std::coroutine_handle<> sleeping;
+
+	{
+		std::unique_lock<std::mutex> lock(ctx->mtx);
+
+		std::swap(parked, ctx->parked);
+		std::swap(sleeping, ctx->sleeping);
+
+		// 到期的定时不再恢复
+		ctx->sleep_seq++;
+		timer_.cancel(ctx->timer);
+	}
+
+	// 未启动的协程也执行，由协程检测退出状态
+	if (parked) resume(ctx, parked);
+	if (sleeping) resume(ctx, sleeping);
+}
+
+bool TaskCoScheduler::destroy(const uint64_t &tid)
+{
+	auto ctx = find(tid);
+
+	if (!ctx) return false;
+
+	{
+		std::unique_lock<std::mutex> lock(ctx->mtx);
+
+		// 正在执行或已提交执行
+		if (!ctx->parked && !ctx->sleeping) return false;
+
+		ctx->parked = nullptr;
+		ctx->sleeping = nullptr;
+		ctx->sleep_seq++;
+		timer_.cancel(ctx->timer);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		tasks_.erase(tid);
+	}
+
+	// 根协程销毁时逐层销毁等待中的子协程
+	ctx->root.destroy();
+
+	return true;
+}
+
+void TaskCoScheduler::finish(TaskCoContext *ctx)
+{
+	TaskCoScheduler *sched = ctx->sched;
+	TaskRef ref = ctx->ref;
+
+	{
+		std::unique_lock<std::mutex> lock(sched->mtx_);
+		sched->tasks_.erase(ctx->tid);
+	}
+
+	Task::task_quit(ref);
+}
+
+bool TaskCoScheduler::paused(TaskCoContext *ctx) noexcept
+{
+	return e_task_wait == ctx->ref.task->task_state.state.load(std::memory_order_acquire);
+}
+
+bool TaskCoScheduler::alive(TaskCoContext *ctx) noexcept
+{
+	TaskDesc *task = ctx->ref.task;
+
+	// 已被清理或描述符已复用
+	if (ctx->ref.gen != task->gen.load(std::memory_order_acquire) || ctx->tid != task->tid) return false;
+
+	if (e_task_alive != task->task_state.state.load(std::memory_order_acquire)) return false;
+
+	Task::heartbeat(task, false);
+
+	return true;
+}
+
+bool TaskCoScheduler::park(TaskCoContext *ctx, std::coroutine_handle<> h)
+{
+	TaskCoScheduler *sched = ctx->sched;
+
+	{
+		std::unique_lock<std::mutex> lock(sched->mtx_);
+
+		if (sched->exit_) return false;
+	}
+
+	std::unique_lock<std::mutex> lock(ctx->mtx);
+
+	// task_continue先修改状态再取出挂起的协程，持锁检测状态不会错过
+	if (!paused(ctx)) return false;
+
+	ctx->parked = h;
+
+	return true;
+}
+
+bool TaskCoScheduler::sleep(TaskCoContext *ctx, std::coroutine_handle<> h, const std::chrono::steady_clock::time_point &deadline)
+{
+	TaskCoScheduler *sched = ctx->sched;
+
+	{
+		std::unique_lock<std::mutex> lock(sched->mtx_);
+
+		if (sched->exit_) return false;
+	}
+
+	std::unique_lock<std::mutex> lock(ctx->mtx);
+
+	enum task_state state = ctx->ref.task->task_state.state.load(std::memory_order_acquire);
+
+	// task_exit先修改状态再取出挂起的协程，已结束则不再休眠
+	if (e_task_alive != state && e_task_wait != state) return false;
+
+	uint64_t seq = ++ctx->sleep_seq;
+	std::shared_ptr<TaskCoContext> self = ctx->shared_from_this();
+
+	ctx->sleeping = h;
+	ctx->timer = sched->timer_.schedule_at(deadline, [sched, self, seq]() { sched->wake(self, seq); }).id;
+
+	return true;
+}
+
+void TaskCoScheduler::wake(const std::shared_ptr<TaskCoContext> &ctx, const uint64_t &seq)
+{
+	std::coroutine_handle<> h;
+
+	{
+		std::unique_lock<std::mutex> lock(ctx->mtx);
+
+		if (seq != ctx->sleep_seq) return;
+
+		std::swap(h, ctx->sleeping);
+	}
+
+	// 已在工作线程上，直接恢复
+	if (h) run(ctx.get(), h);
+}
+
+} // namespace wotsen
@@ -0,0 +1,387 @@
+/**
+ * @file task_coroutine.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 协程任务
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <exception>
+#include <coroutine>
+#include <stdexcept>
+#include <unordered_map>
+#include "task.h"
+#include "task_pool.h"
+#include "task_timer.h"
+
+namespace wotsen
+{
+
+/**
+ * @brief 协程任务运行上下文
+ *
+ */
+struct TaskCoContext : std::enable_shared_from_this<TaskCoContext>
+{
+	TaskRef ref;					  ///< 任务引用
+	uint64_t tid;					  ///< 任务id
+	TaskCoScheduler *sched;			  ///< 所属调度
+	std::coroutine_handle<> root;	  ///< 根协程，强制结束时销毁
+	std::mutex mtx;					  ///< 挂起状态锁
+	std::coroutine_handle<> parked;	  ///< 未启动或暂停中挂起的协程
+	std::coroutine_handle<> sleeping; ///< 休眠中挂起的协程
+	uint64_t timer;					  ///< 休眠定时句柄
+	uint64_t sleep_seq;				  ///< 休眠序号，过期的定时不再恢复
+
+	TaskCoContext() : tid(INVALID_TASK_ID), sched(nullptr), timer(TaskTimer::INVALID_TIMER), sleep_seq(0) {}
+};
+
+/**
+ * @brief 协程任务调度
+ *
+ * 协程在任务池上执行，休眠使用定时服务，挂起时不占用线程。
+ * 任务状态、心跳和超时检测与线程任务一致，task_run启动，task_wait暂停，task_exit结束。
+ */
+class TaskCoScheduler
+{
+public:
+	TaskCoScheduler();
+	~TaskCoScheduler();
+
+	TaskCoScheduler(const TaskCoScheduler &) = delete;
+	TaskCoScheduler &operator=(const TaskCoScheduler &) = delete;
+
+public:
+	// 添加协程任务，根协程挂起等待启动
+	void add(const std::shared_ptr<TaskCoContext> &ctx);
+	// 恢复未启动或暂停中的协程
+	void resume_parked(const uint64_t &tid);
+	// 任务结束，恢复所有挂起的协程
+	void stop(const uint64_t &tid);
+	// 销毁挂起中的协程，正在执行时返回false
+	bool destroy(const uint64_t &tid);
+
+	// 当前线程正在执行的协程任务
+	static TaskCoContext *current(void) noexcept;
+	// 根协程结束
+	static void finish(TaskCoContext *ctx);
+	// 任务是否暂停中
+	static bool paused(TaskCoContext *ctx) noexcept;
+	// 暂停中挂起h直到继续或结束，已不是暂停状态时返回false不挂起
+	static bool park(TaskCoContext *ctx, std::coroutine_handle<> h);
+	// 任务存活时心跳，返回是否存活
+	static bool alive(TaskCoContext *ctx) noexcept;
+	// 休眠到deadline，任务已结束时返回false不挂起
+	static bool sleep(TaskCoContext *ctx, std::coroutine_handle<> h, const std::chrono::steady_clock::time_point &deadline);
+
+private:
+	// 查找协程任务
+	std::shared_ptr<TaskCoContext> find(const uint64_t &tid);
+	// 在任务池上恢复协程
+	void resume(const std::shared_ptr<TaskCoContext> &ctx, std::coroutine_handle<> h);
+	// 在当前线程恢复协程
+	static void run(TaskCoContext *ctx, std::coroutine_handle<> h);
+	// 休眠到期
+	void wake(const std::shared_ptr<TaskCoContext> &ctx, const uint64_t &seq);
+
+private:
+	std::mutex mtx_;															///< 任务锁
+	std::unordered_map<uint64_t, std::shared_ptr<TaskCoContext>> tasks_;		///< 协程任务
+	bool exit_;																	///< 退出标记，之后不再挂起
+	TaskPool pool_;																///< 工作线程
+	TaskTimer timer_;															///< 休眠定时，先于工作线程销毁
+};
+
+/**
+ * @brief 协程返回值
+ *
+ */
+struct TaskCoPromiseBase
+{
+	std::coroutine_handle<> continuation; ///< 等待本协程的协程
+	std::exception_ptr error;			  ///< 异常
+
+	/**
+	 * @brief 结束时转到等待的协程
+	 *
+	 */
+	struct FinalAwaiter
+	{
+		bool await_ready(void) noexcept { return false; }
+
+		template <typename P>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+		{
+			std::coroutine_handle<> next = h.promise().continuation;
+
+			return next ? next : std::noop_coroutine();
+		}
+
+		void await_resume(void) noexcept {}
+	};
+
+	// 创建时不执行
+	std::suspend_always initial_suspend(void) noexcept { return {}; }
+	FinalAwaiter final_suspend(void) noexcept { return {}; }
+	void unhandled_exception(void) noexcept { error = std::current_exception(); }
+};
+
+/**
+ * @brief 协程任务
+ *
+ * 作为Task::register_task的返回值时注册为受监控的协程任务，也可以在协程任务中co_await。
+ *
+ * @tparam T : co_return的类型
+ */
+template <typename T>
+class co_task
+{
+public:
+	struct promise_type : TaskCoPromiseBase
+	{
+		std::optional<T> value; ///< 返回值
+
+		co_task get_return_object(void) noexcept
+		{
+			return co_task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		template <typename V>
+		void return_value(V &&v)
+		{
+			value.emplace(std::forward<V>(v));
+		}
+	};
+
+public:
+	co_task(co_task &&other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+	co_task(const co_task &) = delete;
+	co_task &operator=(const co_task &) = delete;
+	co_task &operator=(co_task &&) = delete;
+
+	~co_task()
+	{
+		if (handle_) handle_.destroy();
+	}
+
+public:
+	bool await_ready(void) const noexcept { return false; }
+
+	// 开始执行，结束后恢复等待者
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) noexcept
+	{
+		handle_.promise().continuation = h;
+
+		return handle_;
+	}
+
+	T await_resume(void)
+	{
+		if (handle_.promise().error) std::rethrow_exception(handle_.promise().error);
+
+		return std::move(*handle_.promise().value);
+	}
+
+private:
+	explicit co_task(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+private:
+	std::coroutine_handle<promise_type> handle_; ///< 协程
+};
+
+template <>
+class co_task<void>
+{
+public:
+	struct promise_type : TaskCoPromiseBase
+	{
+		co_task get_return_object(void) noexcept
+		{
+			return co_task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		void return_void(void) noexcept {}
+	};
+
+public:
+	co_task(co_task &&other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+	co_task(const co_task &) = delete;
+	co_task &operator=(const co_task &) = delete;
+	co_task &operator=(co_task &&) = delete;
+
+	~co_task()
+	{
+		if (handle_) handle_.destroy();
+	}
+
+public:
+	bool await_ready(void) const noexcept { return false; }
+
+	std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) noexcept
+	{
+		handle_.promise().continuation = h;
+
+		return handle_;
+	}
+
+	void await_resume(void)
+	{
+		if (handle_.promise().error) std::rethrow_exception(handle_.promise().error);
+	}
+
+private:
+	explicit co_task(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+private:
+	std::coroutine_handle<promise_type> handle_; ///< 协程
+};
+
+/**
+ * @brief 协程休眠
+ *
+ */
+struct TaskCoSleep
+{
+	std::chrono::steady_clock::time_point deadline; ///< 截止时间
+
+	bool await_ready(void) const noexcept { return std::chrono::steady_clock::now() >= deadline; }
+
+	bool await_suspend(std::coroutine_handle<> h)
+	{
+		TaskCoContext *ctx = TaskCoScheduler::current();
+
+		if (!ctx) throw std::logic_error("sleep out of coroutine task");
+
+		return TaskCoScheduler::sleep(ctx, h, deadline);
+	}
+
+	void await_resume(void) const noexcept {}
+};
+
+/**
+ * @brief 协程任务存活检测点
+ *
+ */
+struct TaskCoWaitPoint
+{
+	TaskCoContext *ctx; ///< 当前协程任务
+
+	// 非暂停状态不挂起
+	bool await_ready(void) const noexcept { return !TaskCoScheduler::paused(ctx); }
+
+	bool await_suspend(std::coroutine_handle<> h) { return TaskCoScheduler::park(ctx, h); }
+
+	bool await_resume(void) const noexcept { return TaskCoScheduler::alive(ctx); }
+};
+
+// 协程休眠，不占用线程，任务结束时提前返回
+template <typename Rep, typename Period>
+inline TaskCoSleep sleep_for(const std::chrono::duration<Rep, Period> &rel_time)
+{
+	return {std::chrono::steady_clock::now()
+			+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(rel_time)};
+}
+
+inline TaskCoSleep sleep_until(const std::chrono::steady_clock::time_point &abs_time)
+{
+	return {abs_time};
+}
+
+/**
+ * @brief 协程任务心跳，对应线程任务的Task::task_alive
+ *
+ * 存活时心跳，暂停时挂起直到继续，co_await结果为false时任务应结束。
+ *
+ * [NOTE]:GCC 12在while/if条件中co_await会生成错误代码，先赋值给变量再判断
+ */
+inline TaskCoWaitPoint task_wait_point(void)
+{
+	TaskCoContext *ctx = TaskCoScheduler::current();
+
+	if (!ctx) throw std::logic_error("wait point out of coroutine task");
+
+	return {ctx};
+}
+
+/**
+ * @brief 根协程，结束时自动销毁
+ *
+ */
+struct TaskCoRoot
+{
+	struct promise_type
+	{
+		TaskCoRoot get_return_object(void) noexcept
+		{
+			return {std::coroutine_handle<promise_type>::from_promise(*this)};
+		}
+
+		std::suspend_always initial_suspend(void) noexcept { return {}; }
+		std::suspend_never final_suspend(void) noexcept { return {}; }
+		void return_void(void) noexcept {}
+		void unhandled_exception(void) noexcept { std::terminate(); }
+	};
+
+	std::coroutine_handle<promise_type> handle; ///< 协程
+};
+
+// 执行协程任务，设置返回值后通知任务结束
+template <typename T>
+TaskCoRoot task_co_root(co_task<T> task, TaskPromise<T> done, std::shared_ptr<TaskCoContext> ctx)
+{
+	try
+	{
+		if constexpr (std::is_void<T>::value)
+		{
+			co_await task;
+			done.set_value();
+		}
+		else
+		{
+			done.set_value(co_await task);
+		}
+	}
+	catch (...)
+	{
+		done.set_exception(std::current_exception());
+	}
+
+	TaskCoScheduler::finish(ctx.get());
+}
+
+template <typename F, typename... Args>
+TaskKey<task_result_type<F, Args...>>
+Task::register_coroutine(const TaskRegisterInfo &reg_info, F &&f, Args &&... args)
+{
+	using R = task_result_type<F, Args...>;
+
+	TaskKey<R> ret;
+	TaskPromise<R> done;
+	auto ctx = std::make_shared<TaskCoContext>();
+
+	ret.fut = done.get_future();
+	ret.policy = e_task_sched_inherit;
+
+	// 协程创建后挂起，task_run时开始执行
+	ctx->root = task_co_root<R>(std::invoke(std::forward<F>(f), std::forward<Args>(args)...), std::move(done), ctx).handle;
+
+	if (!task_ptr()->add_coroutine(ret.tid, reg_info, ctx))
+	{
+		// 返回值置为broken_promise
+		ctx->root.destroy();
+		throw std::invalid_argument("add coroutine task failed");
+	}
+
+	return ret;
+}
+
+} // namespace wotsen
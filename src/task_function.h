@@ -0,0 +1,189 @@
+/**
+ * @file task_function.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 可调用对象
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <new>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+namespace wotsen
+{
+
+template <typename Sig>
+class TaskFunction;
+
+/**
+ * @brief 只移动的可调用对象
+ *
+ * 不超过INLINE_SIZE且可无异常移动的可调用对象直接存放在对象内部，不申请内存，
+ * 否则存放在堆上。对象大小为一个缓存行。
+ *
+ * @tparam R : 返回值类型
+ * @tparam Args : 参数类型
+ */
+template <typename R, typename... Args>
+class TaskFunction<R(Args...)>
+{
+public:
+	static constexpr size_t INLINE_SIZE = 6 * sizeof(void *); ///< 内联存储大小
+
+public:
+	TaskFunction() noexcept : ops_(nullptr) {}
+	TaskFunction(std::nullptr_t) noexcept : ops_(nullptr) {}
+
+	template <typename F,
+			  typename = typename std::enable_if<!std::is_same<typename std::decay<F>::type, TaskFunction>::value>::type>
+	TaskFunction(F &&f) : ops_(nullptr)
+	{
+		using T = typename std::decay<F>::type;
+
+		if constexpr (is_inline<T>())
+		{
+			new (buf_) T(std::forward<F>(f));
+			ops_ = &InlineOps<T>::ops;
+		}
+		else
+		{
+			*reinterpret_cast<T **>(buf_) = new T(std::forward<F>(f));
+			ops_ = &HeapOps<T>::ops;
+		}
+	}
+
+	TaskFunction(TaskFunction &&other) noexcept : ops_(other.ops_)
+	{
+		if (ops_)
+		{
+			ops_->move(buf_, other.buf_);
+			other.ops_ = nullptr;
+		}
+	}
+
+	TaskFunction &operator=(TaskFunction &&other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+
+			if (other.ops_)
+			{
+				ops_ = other.ops_;
+				ops_->move(buf_, other.buf_);
+				other.ops_ = nullptr;
+			}
+		}
+
+		return *this;
+	}
+
+	TaskFunction &operator=(std::nullptr_t) noexcept
+	{
+		reset();
+
+		return *this;
+	}
+
+	TaskFunction(const TaskFunction &) = delete;
+	TaskFunction &operator=(const TaskFunction &) = delete;
+
+	~TaskFunction() { reset(); }
+
+public:
+	explicit operator bool() const noexcept { return nullptr != ops_; }
+
+	R operator()(Args... args)
+	{
+		if (!ops_) throw std::bad_function_call();
+
+		return ops_->invoke(buf_, std::forward<Args>(args)...);
+	}
+
+	// 可调用对象是否会内联存储
+	template <typename T>
+	static constexpr bool is_inline(void) noexcept
+	{
+		return sizeof(T) <= INLINE_SIZE
+				&& alignof(T) <= alignof(std::max_align_t)
+				&& std::is_nothrow_move_constructible<T>::value;
+	}
+
+private:
+	/**
+	 * @brief 类型擦除操作
+	 *
+	 */
+	struct Ops
+	{
+		R (*invoke)(void *, Args &&...);		 ///< 调用
+		void (*move)(void *, void *) noexcept; ///< 移动到新位置并析构原对象
+		void (*destroy)(void *) noexcept;		 ///< 析构
+	};
+
+	template <typename T>
+	struct InlineOps
+	{
+		static R invoke(void *p, Args &&... args)
+		{
+			return static_cast<R>((*static_cast<T *>(p))(std::forward<Args>(args)...));
+		}
+
+		static void move(void *dst, void *src) noexcept
+		{
+			new (dst) T(std::move(*static_cast<T *>(src)));
+			static_cast<T *>(src)->~T();
+		}
+
+		static void destroy(void *p) noexcept
+		{
+			static_cast<T *>(p)->~T();
+		}
+
+		static constexpr Ops ops = {&invoke, &move, &destroy};
+	};
+
+	template <typename T>
+	struct HeapOps
+	{
+		static R invoke(void *p, Args &&... args)
+		{
+			return static_cast<R>((**static_cast<T **>(p))(std::forward<Args>(args)...));
+		}
+
+		static void move(void *dst, void *src) noexcept
+		{
+			*static_cast<T **>(dst) = *static_cast<T **>(src);
+		}
+
+		static void destroy(void *p) noexcept
+		{
+			delete *static_cast<T **>(p);
+		}
+
+		static constexpr Ops ops = {&invoke, &move, &destroy};
+	};
+
+	void reset(void) noexcept
+	{
+		if (ops_)
+		{
+			ops_->destroy(buf_);
+			ops_ = nullptr;
+		}
+	}
+
+private:
+	alignas(std::max_align_t) unsigned char buf_[INLINE_SIZE]; ///< 存储
+	const Ops *ops_;											///< 操作
+};
+
+} // namespace wotsen
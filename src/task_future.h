@@ -0,0 +1,715 @@
+/**
+ * @file task_future.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 任务返回值
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <tuple>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <exception>
+#include <condition_variable>
+#include <cxxabi.h>
+#include "task_function.h"
+
+namespace wotsen
+{
+
+/**
+ * @brief 共享状态，引用计数
+ *
+ */
+class TaskSharedStateBase
+{
+public:
+	TaskSharedStateBase() noexcept : refs_(1), ready_(false) {}
+	virtual ~TaskSharedStateBase() {}
+
+	TaskSharedStateBase(const TaskSharedStateBase &) = delete;
+	TaskSharedStateBase &operator=(const TaskSharedStateBase &) = delete;
+
+public:
+	// 增加引用
+	void ref(void) noexcept { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+	// 释放引用
+	void unref(void) noexcept
+	{
+		if (1 == refs_.fetch_sub(1, std::memory_order_acq_rel)) delete this;
+	}
+
+	// 是否已设置结果
+	bool ready(void) const noexcept { return ready_.load(std::memory_order_acquire); }
+
+	// 等待结果
+	void wait(void)
+	{
+		if (ready()) return;
+
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		while (!ready_.load(std::memory_order_relaxed)) cond_.wait(lock);
+	}
+
+	// 等待结果，带超时
+	template <typename Clock, typename Duration>
+	std::future_status wait_until(const std::chrono::time_point<Clock, Duration> &abs_time)
+	{
+		if (ready()) return std::future_status::ready;
+
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		return cond_.wait_until(lock, abs_time, [this]() { return ready_.load(std::memory_order_relaxed); })
+				? std::future_status::ready
+				: std::future_status::timeout;
+	}
+
+	// 设置异常
+	void set_exception(std::exception_ptr error)
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		check_satisfied();
+		error_ = error;
+		make_ready(lock);
+	}
+
+	// 结果不会再设置，未设置时置为broken_promise
+	void abandon(void)
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		if (ready_.load(std::memory_order_relaxed)) return;
+
+		error_ = std::make_exception_ptr(std::future_error(std::future_errc::broken_promise));
+		make_ready(lock);
+	}
+
+	// 结果就绪时执行，已就绪则立即在当前线程执行，只能设置一次
+	void on_ready(TaskFunction<void()> &&callback)
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		if (!ready_.load(std::memory_order_relaxed))
+		{
+			callback_ = std::move(callback);
+			return;
+		}
+
+		lock.unlock();
+		callback();
+	}
+
+	// 执行打包的任务，只有打包任务才有实现
+	virtual void run(void) {}
+
+protected:
+	// 已设置结果则抛出异常，需持有锁
+	void check_satisfied(void) const
+	{
+		if (ready_.load(std::memory_order_relaxed))
+		{
+			throw std::future_error(std::future_errc::promise_already_satisfied);
+		}
+	}
+
+	// 结果就绪，释放锁后在设置结果的线程上执行后续回调
+	void make_ready(std::unique_lock<std::mutex> &lock)
+	{
+		ready_.store(true, std::memory_order_release);
+		cond_.notify_all();
+
+		TaskFunction<void()> callback(std::move(callback_));
+
+		lock.unlock();
+
+		if (!callback) return;
+
+		// 本结果已设置，回调异常(如执行器post失败)不能再传给设置者，否则会对已就绪的结果再次set_exception；
+		// 回调持有的后续promise随回调析构，后续结果为broken_promise
+		try
+		{
+			callback();
+		}
+		catch (abi::__forced_unwind &)
+		{
+			throw;
+		}
+		catch (...)
+		{
+		}
+	}
+
+	// 有异常则抛出
+	void rethrow(void) const
+	{
+		if (error_) std::rethrow_exception(error_);
+	}
+
+protected:
+	std::mutex mtx_;				///< 结果锁
+	std::exception_ptr error_;		///< 异常
+
+private:
+	std::atomic<uint32_t> refs_;	 ///< 引用计数
+	std::atomic<bool> ready_;		 ///< 结果就绪
+	std::condition_variable cond_; ///< 等待结果
+	TaskFunction<void()> callback_; ///< 结果就绪后执行
+};
+
+/**
+ * @brief 共享状态
+ *
+ * @tparam T : 结果类型
+ */
+template <typename T>
+class TaskSharedState : public TaskSharedStateBase
+{
+	static_assert(!std::is_reference<T>::value, "TaskSharedState not support reference");
+
+public:
+	// 设置结果
+	template <typename V>
+	void set_value(V &&value)
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		check_satisfied();
+		value_.emplace(std::forward<V>(value));
+		make_ready(lock);
+	}
+
+	// 取出结果，需先等待
+	T take(void)
+	{
+		rethrow();
+
+		return std::move(*value_);
+	}
+
+private:
+	std::optional<T> value_; ///< 结果
+};
+
+template <>
+class TaskSharedState<void> : public TaskSharedStateBase
+{
+public:
+	// 设置结果
+	void set_value(void)
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		check_satisfied();
+		make_ready(lock);
+	}
+
+	// 取出结果，需先等待
+	void take(void)
+	{
+		rethrow();
+	}
+};
+
+/**
+ * @brief 打包任务，可调用对象与结果在同一块内存
+ *
+ * @tparam R : 结果类型
+ * @tparam F : 可调用对象
+ */
+template <typename R, typename F>
+class TaskPackagedState : public TaskSharedState<R>
+{
+public:
+	explicit TaskPackagedState(F &&fn) : fn_(std::move(fn)) {}
+
+public:
+	void run(void) override
+	{
+		try
+		{
+			invoke(std::is_void<R>());
+		}
+		catch (abi::__forced_unwind &)
+		{
+			// 线程被取消，继续展开，由执行器置为broken_promise
+			throw;
+		}
+		catch (...)
+		{
+			this->set_exception(std::current_exception());
+		}
+	}
+
+private:
+	void invoke(std::true_type)
+	{
+		fn_();
+		this->set_value();
+	}
+
+	void invoke(std::false_type)
+	{
+		this->set_value(fn_());
+	}
+
+private:
+	F fn_; ///< 可调用对象
+};
+
+/**
+ * @brief 打包任务执行器，持有一个引用，只能执行一次，未执行就销毁时结果置为broken_promise
+ *
+ */
+class TaskRunner
+{
+public:
+	explicit TaskRunner(TaskSharedStateBase *state) noexcept : state_(state) {}
+	TaskRunner(TaskRunner &&other) noexcept : state_(other.state_) { other.state_ = nullptr; }
+	TaskRunner(const TaskRunner &) = delete;
+	TaskRunner &operator=(const TaskRunner &) = delete;
+	TaskRunner &operator=(TaskRunner &&) = delete;
+
+	~TaskRunner()
+	{
+		if (state_)
+		{
+			state_->abandon();
+			state_->unref();
+		}
+	}
+
+	void operator()(void)
+	{
+		if (state_) state_->run();
+	}
+
+private:
+	TaskSharedStateBase *state_; ///< 共享状态
+};
+
+template <typename T>
+class TaskPromise;
+
+template <typename T, typename R, typename F>
+struct TaskContinuation;
+
+/**
+ * @brief 在提交的线程上直接执行
+ *
+ * 执行器只需提供post(TaskFunction<void()> &&)，TaskPool也可作为执行器
+ */
+struct TaskInlineExecutor
+{
+	void post(TaskFunction<void()> &&job) { job(); }
+};
+
+/**
+ * @brief 任务返回值，只能获取一次
+ *
+ * @tparam T : 结果类型
+ */
+template <typename T>
+class TaskFuture
+{
+public:
+	TaskFuture() noexcept : state_(nullptr) {}
+	// 接管一个引用
+	explicit TaskFuture(TaskSharedState<T> *state) noexcept : state_(state) {}
+	TaskFuture(TaskFuture &&other) noexcept : state_(other.state_) { other.state_ = nullptr; }
+
+	TaskFuture &operator=(TaskFuture &&other) noexcept
+	{
+		if (this != &other)
+		{
+			if (state_) state_->unref();
+
+			state_ = other.state_;
+			other.state_ = nullptr;
+		}
+
+		return *this;
+	}
+
+	TaskFuture(const TaskFuture &) = delete;
+	TaskFuture &operator=(const TaskFuture &) = delete;
+
+	~TaskFuture()
+	{
+		if (state_) state_->unref();
+	}
+
+public:
+	// 是否关联结果
+	bool valid(void) const noexcept { return nullptr != state_; }
+
+	// 结果是否就绪
+	bool ready(void) const noexcept { return state_ && state_->ready(); }
+
+	// 等待结果
+	void wait(void) const
+	{
+		check();
+		state_->wait();
+	}
+
+	template <typename Rep, typename Period>
+	std::future_status wait_for(const std::chrono::duration<Rep, Period> &rel_time) const
+	{
+		return wait_until(std::chrono::steady_clock::now() + rel_time);
+	}
+
+	template <typename Clock, typename Duration>
+	std::future_status wait_until(const std::chrono::time_point<Clock, Duration> &abs_time) const
+	{
+		check();
+
+		return state_->wait_until(abs_time);
+	}
+
+	// 获取结果，获取后不再关联
+	T get(void)
+	{
+		check();
+		state_->wait();
+
+		/**
+		 * @brief 取出结果后释放引用
+		 *
+		 */
+		struct Release
+		{
+			TaskSharedState<T> *state;
+
+			~Release() { state->unref(); }
+		} release{state_};
+
+		state_ = nullptr;
+
+		return release.state->take();
+	}
+
+	/**
+	 * @brief 结果就绪后执行f，不阻塞等待，调用后不再关联
+	 *
+	 * f的参数为已就绪的TaskFuture<T>，在设置结果的线程上执行，调用时已就绪则在当前线程执行。
+	 * f的返回值或异常通过返回的future传出。
+	 *
+	 * @param f : 后续任务
+	 * @return TaskFuture : f的返回值
+	 */
+	template <typename F>
+	TaskFuture<std::invoke_result_t<std::decay_t<F>, TaskFuture<T>>> then(F &&f)
+	{
+		TaskInlineExecutor executor;
+
+		return then(executor, std::forward<F>(f));
+	}
+
+	/**
+	 * @brief 结果就绪后提交f到执行器
+	 *
+	 * @param executor : 执行器，结果就绪前不能销毁
+	 * @param f : 后续任务
+	 * @return TaskFuture : f的返回值，执行器丢弃f时为broken_promise
+	 */
+	template <typename E, typename F>
+	TaskFuture<std::invoke_result_t<std::decay_t<F>, TaskFuture<T>>> then(E &executor, F &&f)
+	{
+		using R = std::invoke_result_t<std::decay_t<F>, TaskFuture<T>>;
+
+		check();
+
+		TaskSharedState<T> *state = state_;
+		TaskContinuation<T, R, std::decay_t<F>> next{std::move(*this), TaskPromise<R>(), std::forward<F>(f)};
+		TaskFuture<R> ret = next.done.get_future();
+
+		// 后续任务持有本结果的引用，结果就绪时取出执行
+		state->on_ready([&executor, next = std::move(next)]() mutable { executor.post(std::move(next)); });
+
+		return ret;
+	}
+
+private:
+	void check(void) const
+	{
+		if (!state_) throw std::future_error(std::future_errc::no_state);
+	}
+
+private:
+	TaskSharedState<T> *state_; ///< 共享状态
+};
+
+/**
+ * @brief 任务结果设置
+ *
+ * @tparam T : 结果类型
+ */
+template <typename T>
+class TaskPromise
+{
+public:
+	TaskPromise() : state_(new TaskSharedState<T>), retrieved_(false) {}
+	TaskPromise(TaskPromise &&other) noexcept : state_(other.state_), retrieved_(other.retrieved_) { other.state_ = nullptr; }
+	TaskPromise(const TaskPromise &) = delete;
+	TaskPromise &operator=(const TaskPromise &) = delete;
+	TaskPromise &operator=(TaskPromise &&) = delete;
+
+	~TaskPromise()
+	{
+		if (state_)
+		{
+			state_->abandon();
+			state_->unref();
+		}
+	}
+
+public:
+	// 获取返回值，只能获取一次
+	TaskFuture<T> get_future(void)
+	{
+		check();
+
+		if (retrieved_) throw std::future_error(std::future_errc::future_already_retrieved);
+
+		retrieved_ = true;
+		state_->ref();
+
+		return TaskFuture<T>(state_);
+	}
+
+	// 设置结果
+	template <typename... V>
+	void set_value(V &&... value)
+	{
+		check();
+		state_->set_value(std::forward<V>(value)...);
+	}
+
+	// 设置异常
+	void set_exception(std::exception_ptr error)
+	{
+		check();
+		state_->set_exception(error);
+	}
+
+private:
+	void check(void) const
+	{
+		if (!state_) throw std::future_error(std::future_errc::no_state);
+	}
+
+private:
+	TaskSharedState<T> *state_; ///< 共享状态
+	bool retrieved_;			///< 已获取返回值
+};
+
+/**
+ * @brief 后续任务
+ *
+ * @tparam T : 前一任务结果类型
+ * @tparam R : 后续任务结果类型
+ * @tparam F : 后续任务
+ */
+template <typename T, typename R, typename F>
+struct TaskContinuation
+{
+	TaskFuture<T> fut;	 ///< 已就绪的前一任务结果
+	TaskPromise<R> done; ///< 后续任务结果
+	F fn;				 ///< 后续任务
+
+	void operator()(void)
+	{
+		try
+		{
+			if constexpr (std::is_void<R>::value)
+			{
+				fn(std::move(fut));
+				done.set_value();
+			}
+			else
+			{
+				done.set_value(fn(std::move(fut)));
+			}
+		}
+		catch (...)
+		{
+			done.set_exception(std::current_exception());
+		}
+	}
+};
+
+/**
+ * @brief 任意一个结果就绪
+ *
+ * @tparam T : 结果类型
+ */
+template <typename T>
+struct TaskWhenAny
+{
+	size_t index;		   ///< 就绪的序号
+	TaskFuture<T> future; ///< 就绪的结果
+};
+
+/**
+ * @brief 所有结果就绪，不阻塞等待
+ *
+ * @param futures : 结果
+ * @return TaskFuture : 全部就绪后的结果，顺序不变
+ */
+template <typename T>
+TaskFuture<std::vector<TaskFuture<T>>> when_all(std::vector<TaskFuture<T>> futures)
+{
+	/**
+	 * @brief 等待上下文
+	 *
+	 */
+	struct Context
+	{
+		std::vector<TaskFuture<T>> futures;		 ///< 已就绪的结果
+		std::atomic<size_t> count;					 ///< 未就绪数量
+		TaskPromise<std::vector<TaskFuture<T>>> done; ///< 全部就绪
+	};
+
+	auto ctx = std::make_shared<Context>();
+	auto ret = ctx->done.get_future();
+	size_t size = futures.size();
+
+	if (0 == size)
+	{
+		ctx->done.set_value(std::move(ctx->futures));
+		return ret;
+	}
+
+	ctx->futures.resize(size);
+	ctx->count.store(size, std::memory_order_relaxed);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		futures[i].then([ctx, i](TaskFuture<T> fut) {
+			ctx->futures[i] = std::move(fut);
+
+			if (1 == ctx->count.fetch_sub(1, std::memory_order_acq_rel)) ctx->done.set_value(std::move(ctx->futures));
+		});
+	}
+
+	return ret;
+}
+
+/**
+ * @brief 所有结果就绪，结果类型可以不同
+ *
+ * @return TaskFuture : 全部就绪后的结果
+ */
+template <typename... T>
+TaskFuture<std::tuple<TaskFuture<T>...>> when_all(TaskFuture<T> &&... futures)
+{
+	/**
+	 * @brief 等待上下文
+	 *
+	 */
+	struct Context
+	{
+		std::tuple<TaskFuture<T>...> futures;			   ///< 已就绪的结果
+		std::atomic<size_t> count;						   ///< 未就绪数量
+		TaskPromise<std::tuple<TaskFuture<T>...>> done; ///< 全部就绪
+	};
+
+	auto ctx = std::make_shared<Context>();
+	auto ret = ctx->done.get_future();
+
+	ctx->count.store(sizeof...(T), std::memory_order_relaxed);
+
+	if (0 == sizeof...(T))
+	{
+		ctx->done.set_value(std::move(ctx->futures));
+		return ret;
+	}
+
+	[&]<size_t... I>(std::index_sequence<I...>) {
+		(futures.then([ctx](TaskFuture<T> fut) {
+			std::get<I>(ctx->futures) = std::move(fut);
+
+			if (1 == ctx->count.fetch_sub(1, std::memory_order_acq_rel)) ctx->done.set_value(std::move(ctx->futures));
+		}), ...);
+	}(std::index_sequence_for<T...>());
+
+	return ret;
+}
+
+/**
+ * @brief 任意一个结果就绪，不阻塞等待
+ *
+ * @param futures : 结果，不能为空
+ * @return TaskFuture : 第一个就绪的结果及其序号，其余结果就绪后丢弃
+ */
+template <typename T>
+TaskFuture<TaskWhenAny<T>> when_any(std::vector<TaskFuture<T>> futures)
+{
+	/**
+	 * @brief 等待上下文
+	 *
+	 */
+	struct Context
+	{
+		std::atomic<bool> done_flag;		///< 已有结果就绪
+		TaskPromise<TaskWhenAny<T>> done; ///< 第一个就绪
+	};
+
+	if (futures.empty()) throw std::invalid_argument("when_any with no future");
+
+	auto ctx = std::make_shared<Context>();
+	auto ret = ctx->done.get_future();
+
+	ctx->done_flag.store(false, std::memory_order_relaxed);
+
+	for (size_t i = 0; i < futures.size(); i++)
+	{
+		futures[i].then([ctx, i](TaskFuture<T> fut) {
+			if (!ctx->done_flag.exchange(true, std::memory_order_acq_rel)) ctx->done.set_value(TaskWhenAny<T>{i, std::move(fut)});
+		});
+	}
+
+	return ret;
+}
+
+/**
+ * @brief 打包可调用对象，只申请一次内存
+ *
+ * @param runner : 输出执行器
+ * @param f : 可调用对象
+ * @param args : 参数
+ * @return TaskFuture : 返回值
+ */
+template <typename F, typename... Args>
+auto make_task_packaged(TaskFunction<void()> &runner, F &&f, Args &&... args)
+	-> TaskFuture<std::invoke_result_t<F, Args...>>
+{
+	using R = std::invoke_result_t<F, Args...>;
+	using B = decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+	auto state = new TaskPackagedState<R, B>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+	// 执行器和返回值各持有一个引用
+	state->ref();
+	runner = TaskRunner(state);
+
+	return TaskFuture<R>(state);
+}
+
+} // namespace wotsen
@@ -0,0 +1,183 @@
+/**
+ * @file task_graph.cpp
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 任务依赖图
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include "task_graph.h"
+
+namespace wotsen
+{
+
+void TaskGraph::check_idle(void) const
+{
+	if (running_.load(std::memory_order_acquire)) throw std::logic_error("task graph is running");
+}
+
+void TaskGraph::precede(const size_t &from, const size_t &to)
+{
+	check_idle();
+
+	if (from >= nodes_.size() || to >= nodes_.size() || from == to)
+	{
+		throw std::invalid_argument("invalid task graph node");
+	}
+
+	nodes_[from]->succs.push_back(to);
+	nodes_[to]->preds++;
+}
+
+bool TaskGraph::build_rank(std::vector<size_t> &roots)
+{
+	std::vector<uint32_t> indegree(nodes_.size());
+	std::vector<size_t> order;
+
+	order.reserve(nodes_.size());
+
+	for (size_t i = 0; i < nodes_.size(); i++)
+	{
+		indegree[i] = nodes_[i]->preds;
+
+		if (0 == indegree[i])
+		{
+			roots.push_back(i);
+			order.push_back(i);
+		}
+	}
+
+	// 拓扑排序
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		for (auto &succ : nodes_[order[i]]->succs)
+		{
+			if (0 == --indegree[succ]) order.push_back(succ);
+		}
+	}
+
+	if (order.size() != nodes_.size()) return false;
+
+	// 逆拓扑序计算到出口的最长路径
+	for (auto it = order.rbegin(); it != order.rend(); ++it)
+	{
+		TaskGraphNode *node = nodes_[*it].get();
+		uint64_t longest = 0;
+
+		for (auto &succ : node->succs) longest = std::max(longest, nodes_[succ]->rank);
+
+		node->rank = node->cost + longest;
+	}
+
+	return true;
+}
+
+TaskFuture<void> TaskGraph::run(TaskPool &pool)
+{
+	if (running_.exchange(true, std::memory_order_acq_rel)) throw std::logic_error("task graph is running");
+
+	std::vector<size_t> roots;
+
+	if (!build_rank(roots))
+	{
+		running_.store(false, std::memory_order_release);
+		throw std::invalid_argument("task graph has cycle");
+	}
+
+	done_.reset(new TaskPromise<void>);
+
+	TaskFuture<void> ret = done_->get_future();
+
+	if (nodes_.empty())
+	{
+		running_.store(false, std::memory_order_release);
+		done_->set_value();
+		return ret;
+	}
+
+	for (auto &node : nodes_) node->pending.store(node->preds, std::memory_order_relaxed);
+
+	pool_ = &pool;
+	error_ = nullptr;
+	failed_.store(false, std::memory_order_relaxed);
+	remaining_.store(nodes_.size(), std::memory_order_release);
+	ready_.clear();
+	ready_.reserve(nodes_.size());
+
+	for (auto &root : roots) ready(root);
+
+	return ret;
+}
+
+void TaskGraph::ready(const size_t &node)
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		ready_.push_back({nodes_[node]->rank, node});
+		std::push_heap(ready_.begin(), ready_.end());
+	}
+
+	// 每个就绪节点提交一次执行，执行时取关键路径最长的节点，不一定是本节点
+	pool_->post([this]() { execute(); });
+}
+
+void TaskGraph::execute(void)
+{
+	size_t node = 0;
+
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		std::pop_heap(ready_.begin(), ready_.end());
+		node = ready_.back().node;
+		ready_.pop_back();
+	}
+
+	// 已有节点异常时跳过，仍需传递完成计数
+	if (!failed_.load(std::memory_order_acquire))
+	{
+		try
+		{
+			nodes_[node]->job();
+		}
+		catch (...)
+		{
+			if (!failed_.exchange(true, std::memory_order_acq_rel)) error_ = std::current_exception();
+		}
+	}
+
+	complete(node);
+}
+
+void TaskGraph::complete(const size_t &node)
+{
+	for (auto &succ : nodes_[node]->succs)
+	{
+		if (1 == nodes_[succ]->pending.fetch_sub(1, std::memory_order_acq_rel)) ready(succ);
+	}
+
+	// 最后一个节点结束，之后图可以被修改或销毁，不能再访问成员
+	if (1 != remaining_.fetch_sub(1, std::memory_order_acq_rel)) return;
+
+	std::unique_ptr<TaskPromise<void>> done(std::move(done_));
+	std::exception_ptr error = error_;
+
+	running_.store(false, std::memory_order_release);
+
+	if (error)
+	{
+		done->set_exception(error);
+	}
+	else
+	{
+		done->set_value();
+	}
+}
+
+} // namespace wotsen
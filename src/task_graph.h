@@ -0,0 +1,144 @@
+/**
+ * @file task_graph.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 任务依赖图
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <initializer_list>
+#include "task_pool.h"
+
+namespace wotsen
+{
+
+/**
+ * @brief 依赖图节点
+ *
+ */
+struct TaskGraphNode
+{
+	TaskFunction<void()> job;				///< 节点任务
+	uint64_t cost;							///< 估计耗时，用于计算关键路径
+	uint64_t rank;							///< 到出口的最长路径长度，越大越先执行
+	uint32_t preds;							///< 前驱数量
+	std::atomic<uint32_t> pending;			///< 未完成的前驱数量
+	std::vector<size_t> succs;				///< 后继节点
+};
+
+/**
+ * @brief 任务依赖图
+ *
+ * 节点声明前驱，前驱全部完成后后继立即就绪，相互独立的分支在任务池上并行执行。
+ * 就绪节点按关键路径长度排序，位于最长路径上的节点先执行，缩短整图完成时间。
+ * 节点异常后不再执行未开始的节点，异常通过run返回的future传出。
+ *
+ * [NOTE]:执行期间图不能修改也不能销毁，完成后可再次执行
+ */
+class TaskGraph
+{
+public:
+	TaskGraph() : pool_(nullptr), running_(false), remaining_(0), failed_(false) {}
+	~TaskGraph() = default;
+
+	TaskGraph(const TaskGraph &) = delete;
+	TaskGraph &operator=(const TaskGraph &) = delete;
+
+public:
+	/**
+	 * @brief 添加节点
+	 *
+	 * @param f : 节点任务，无参数无返回值
+	 * @param cost : 估计耗时，单位由使用者决定，只用于比较
+	 * @return size_t : 节点编号
+	 */
+	template <typename F>
+	size_t add(F &&f, const uint64_t &cost = 1)
+	{
+		check_idle();
+
+		std::unique_ptr<TaskGraphNode> node(new TaskGraphNode);
+
+		node->job = TaskFunction<void()>(std::forward<F>(f));
+		node->cost = cost;
+		node->rank = 0;
+		node->preds = 0;
+		node->pending.store(0, std::memory_order_relaxed);
+
+		nodes_.push_back(std::move(node));
+
+		return nodes_.size() - 1;
+	}
+
+	// from完成后才执行to
+	void precede(const size_t &from, const size_t &to);
+
+	// node依赖preds中的所有节点
+	void depend(const size_t &node, std::initializer_list<size_t> preds)
+	{
+		for (auto &pred : preds) precede(pred, node);
+	}
+
+	/**
+	 * @brief 在任务池上执行
+	 *
+	 * @param pool : 任务池
+	 * @return TaskFuture<void> : 所有节点完成后就绪，有节点异常时为第一个异常
+	 * @throw std::invalid_argument : 存在环
+	 * @throw std::logic_error : 正在执行
+	 */
+	TaskFuture<void> run(TaskPool &pool);
+
+	// 节点数量
+	size_t size(void) const noexcept { return nodes_.size(); }
+
+	// 节点的关键路径长度，run之后有效
+	uint64_t rank(const size_t &node) const { return nodes_.at(node)->rank; }
+
+private:
+	/**
+	 * @brief 就绪节点，按关键路径长度排序
+	 *
+	 */
+	struct Ready
+	{
+		uint64_t rank;	///< 关键路径长度
+		size_t node;	///< 节点编号
+
+		bool operator<(const Ready &other) const noexcept { return rank < other.rank; }
+	};
+
+private:
+	// 执行期间不能修改
+	void check_idle(void) const;
+	// 计算关键路径长度，存在环时返回false
+	bool build_rank(std::vector<size_t> &roots);
+	// 节点就绪，提交一次执行
+	void ready(const size_t &node);
+	// 执行一个关键路径最长的就绪节点
+	void execute(void);
+	// 节点结束，后继计数减一
+	void complete(const size_t &node);
+
+private:
+	std::vector<std::unique_ptr<TaskGraphNode>> nodes_;		///< 节点
+	TaskPool *pool_;										///< 执行任务池
+	std::atomic<bool> running_;								///< 执行中
+	std::atomic<size_t> remaining_;							///< 未结束的节点数量
+	std::atomic<bool> failed_;								///< 有节点异常
+	std::exception_ptr error_;								///< 第一个异常
+	std::mutex mtx_;										///< 就绪队列锁
+	std::vector<Ready> ready_;								///< 就绪节点，大顶堆
+	std::unique_ptr<TaskPromise<void>> done_;				///< 整图完成通知
+};
+
+} // namespace wotsen
@@ -0,0 +1,147 @@
+/**
+ * @file task_park.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 任务挂起
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <ctime>
+#include <climits>
+#include <cstdint>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace wotsen
+{
+
+///< 进入futex等待前的自旋次数
+#define TASK_PARK_SPIN 256
+
+// 自旋等待提示
+static inline void task_cpu_relax(void) noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief 基于futex的挂起与唤醒
+ *
+ * 唤醒方先修改等待条件再调用unpark，只是一次原子加和有等待者时的一次FUTEX_WAKE，不加锁。
+ * 等待方先自旋，条件仍未满足再FUTEX_WAIT。等待期间可被线程取消。
+ */
+class TaskParker
+{
+public:
+	TaskParker() noexcept : seq_(0), parkers_(0) {}
+
+	TaskParker(const TaskParker &) = delete;
+	TaskParker &operator=(const TaskParker &) = delete;
+
+public:
+	// 挂起直到done()为真
+	template <typename P>
+	void park(P &&done)
+	{
+		wait(std::forward<P>(done), nullptr, TASK_PARK_SPIN);
+	}
+
+	/**
+	 * @brief 挂起直到done()为真或到达截止时间
+	 * 
+	 * @param done : 唤醒条件
+	 * @param deadline : 截止时间
+	 * @param spin : 进入futex等待前的自旋次数，长时间等待时取0
+	 * @return true : 条件满足
+	 * @return false : 超时
+	 */
+	template <typename P>
+	bool park_until(P &&done, const std::chrono::steady_clock::time_point &deadline, const int &spin = TASK_PARK_SPIN)
+	{
+		auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+		struct timespec ts;
+
+		// steady_clock即CLOCK_MONOTONIC，FUTEX_WAIT_BITSET使用绝对时间，被信号打断后不用重新计算
+		ts.tv_sec = ns < 0 ? 0 : ns / 1000000000;
+		ts.tv_nsec = ns < 0 ? 0 : ns % 1000000000;
+
+		return wait(std::forward<P>(done), &ts, spin);
+	}
+
+	// 唤醒所有挂起者
+	void unpark(void) noexcept
+	{
+		seq_.fetch_add(1, std::memory_order_seq_cst);
+
+		// 没有等待者时不进入内核
+		if (parkers_.load(std::memory_order_seq_cst))
+		{
+			syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq_), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+		}
+	}
+
+private:
+	/**
+	 * @brief 等待者计数，线程取消展开时同样减少
+	 * 
+	 */
+	struct Parking
+	{
+		std::atomic<uint32_t> &parkers;
+
+		explicit Parking(std::atomic<uint32_t> &p) : parkers(p) { parkers.fetch_add(1, std::memory_order_seq_cst); }
+		~Parking() { parkers.fetch_sub(1, std::memory_order_relaxed); }
+	};
+
+	// 挂起直到done()为真，deadline为空时不超时
+	template <typename P>
+	bool wait(P &&done, const struct timespec *deadline, const int &max_spin)
+	{
+		Parking parking(parkers_);
+
+		for (;;)
+		{
+			// 先取序号再检测条件，之后的唤醒会改变序号，不会丢失
+			uint32_t seq = seq_.load(std::memory_order_seq_cst);
+
+			if (done()) return true;
+
+			int spin = 0;
+
+			for (; spin < max_spin && seq == seq_.load(std::memory_order_acquire); spin++) task_cpu_relax();
+
+			if (max_spin == spin)
+			{
+				long ret = syscall(SYS_futex, reinterpret_cast<uint32_t *>(&seq_), FUTEX_WAIT_BITSET_PRIVATE, seq,
+								   deadline, nullptr, FUTEX_BITSET_MATCH_ANY);
+
+				// futex不是取消点，被取消信号中断后在这里响应
+				pthread_testcancel();
+
+				if (ret < 0 && ETIMEDOUT == errno) return done();
+			}
+		}
+	}
+
+private:
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32 bits");
+
+	std::atomic<uint32_t> seq_;		///< 唤醒序号，futex等待字
+	std::atomic<uint32_t> parkers_; ///< 等待者数量
+};
+
+} // namespace wotsen
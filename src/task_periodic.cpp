@@ -0,0 +1,228 @@
+/**
+ * @file task_periodic.cpp
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 周期任务
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <stdexcept>
+#include "task_periodic.h"
+#include "task_auto_manage.h"
+
+namespace wotsen
+{
+extern task_dbg_cb __dbg;
+
+TaskPeriodic::TaskPeriodic() : exit_(false)
+{
+	TaskAttribute attr;
+
+	attr.task_name = "task periodic";
+	attr.stacksize = TASK_STACKSIZE(256);
+	attr.priority = e_sys_task_pri_lv;
+
+	key_ = new_task(attr, [this]() { run(); });
+
+	if (INVALID_TASK_ID == key_.tid) throw std::runtime_error("create periodic task failed.");
+}
+
+TaskPeriodic::~TaskPeriodic()
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		exit_ = true;
+	}
+
+	condition_.notify_one();
+
+	// 等待定时线程结束剩余任务后退出
+	key_.fut.wait();
+}
+
+void TaskPeriodic::add(const TaskRef &ref, const std::chrono::nanoseconds &period, TaskFunction<void()> &&fn, TaskPromise<void> &&done)
+{
+	uint64_t tid = ref.task->tid;
+	std::unique_ptr<Job> job(new Job(ref, tid, period, std::move(fn), std::move(done)));
+	Timer timer{job->deadline, tid};
+
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	jobs_[tid] = std::move(job);
+
+	// 比当前最早的截止时间还早时需要唤醒定时线程重新计算
+	bool earliest = timers_.empty() || timer.deadline < timers_.top().deadline;
+
+	timers_.push(timer);
+
+	if (earliest) condition_.notify_one();
+}
+
+void TaskPeriodic::stop(const uint64_t &tid)
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		stops_.push_back(tid);
+	}
+
+	condition_.notify_one();
+}
+
+void TaskPeriodic::finish(std::unique_lock<std::mutex> &lock, const uint64_t &tid)
+{
+	auto it = jobs_.find(tid);
+
+	if (jobs_.end() == it) return;
+
+	std::unique_ptr<Job> job = std::move(it->second);
+
+	jobs_.erase(it);
+
+	// 任务锁在周期调度锁之前获取，通知退出前先释放
+	lock.unlock();
+
+	if (job->error)
+	{
+		job->done.set_exception(job->error);
+	}
+	else
+	{
+		job->done.set_value();
+	}
+
+	Task::task_quit(job->ref);
+
+	job.reset();
+
+	lock.lock();
+}
+
+bool TaskPeriodic::fire(Job &job)
+{
+	TaskDesc *task = job.ref.task;
+
+	// 任务已被清理或描述符已复用
+	if (job.ref.gen != task->gen.load(std::memory_order_acquire) || job.tid != task->tid) return false;
+
+	clock::time_point _now;
+
+	switch (task->task_state.state.load(std::memory_order_acquire))
+	{
+	case e_task_alive:
+		break;
+
+	case e_task_wait:
+		// 暂停期间不执行也不算超期，对齐到下一个周期点
+		_now = clock::now();
+		job.deadline += job.period * ((_now - job.deadline) / job.period + 1);
+		return true;
+
+	default:
+		return false;
+	}
+
+	try
+	{
+		TaskSelfScope self(job.ref, job.tid);
+
+		job.fn();
+	}
+	catch (...)
+	{
+		task_dbg("periodic task [%ld] throw exception.\n", job.tid);
+		job.error = std::current_exception();
+		return false;
+	}
+
+	// 执行完成即为心跳
+	Task::heartbeat(task, false);
+
+	_now = clock::now();
+	job.deadline += job.period;
+
+	// 执行超过周期，跳过错过的周期点
+	if (_now >= job.deadline)
+	{
+		uint64_t missed = (_now - job.deadline) / job.period + 1;
+		TaskCounter &counter = task->counter;
+
+		counter.overruns.fetch_add(missed, std::memory_order_relaxed);
+		job.deadline += job.period * missed;
+	}
+
+	return true;
+}
+
+void TaskPeriodic::run(void)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	for (;;)
+	{
+		// 先处理停止请求
+		while (!stops_.empty())
+		{
+			uint64_t tid = stops_.back();
+
+			stops_.pop_back();
+			finish(lock, tid);
+		}
+
+		if (exit_)
+		{
+			while (!jobs_.empty()) finish(lock, jobs_.begin()->first);
+
+			break;
+		}
+
+		if (timers_.empty())
+		{
+			condition_.wait(lock);
+			continue;
+		}
+
+		Timer timer = timers_.top();
+		auto it = jobs_.find(timer.tid);
+
+		// 已结束或截止时间已变化
+		if (jobs_.end() == it || it->second->deadline != timer.deadline)
+		{
+			timers_.pop();
+			continue;
+		}
+
+		// 按绝对时间休眠，添加更早的任务或停止时被唤醒
+		if (clock::now() < timer.deadline)
+		{
+			condition_.wait_until(lock, timer.deadline);
+			continue;
+		}
+
+		timers_.pop();
+
+		// 任务只由定时线程删除，解锁期间不会失效
+		Job *job = it->second.get();
+
+		lock.unlock();
+
+		bool ok = fire(*job);
+
+		lock.lock();
+
+		if (ok)
+		{
+			timers_.push({job->deadline, job->tid});
+		}
+		else
+		{
+			finish(lock, job->tid);
+		}
+	}
+
+	task_dbg("task periodic exit.\n");
+}
+
+} // namespace wotsen
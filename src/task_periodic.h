@@ -0,0 +1,105 @@
+/**
+ * @file task_periodic.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 周期任务
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <queue>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <condition_variable>
+#include "task.h"
+
+namespace wotsen
+{
+
+/**
+ * @brief 周期任务调度
+ *
+ * 所有周期任务共用一个定时线程，按绝对截止时间(CLOCK_MONOTONIC)休眠，
+ * 到期后在定时线程上执行任务，执行完成即为一次心跳，截止时间按周期累加，不产生漂移。
+ * 执行超过周期时跳过错过的周期并记录超期次数。
+ *
+ * [NOTE]:任务在定时线程上串行执行，单次执行时间应远小于周期
+ */
+class TaskPeriodic
+{
+public:
+	TaskPeriodic();
+	~TaskPeriodic();
+
+	TaskPeriodic(const TaskPeriodic &) = delete;
+	TaskPeriodic &operator=(const TaskPeriodic &) = delete;
+
+public:
+	// 添加周期任务，首次在一个周期后执行
+	void add(const TaskRef &ref, const std::chrono::nanoseconds &period, TaskFunction<void()> &&fn, TaskPromise<void> &&done);
+	// 停止周期任务，正在执行时执行完成后停止
+	void stop(const uint64_t &tid);
+	// 定时线程调度策略
+	enum task_sched_policy policy(void) const noexcept { return key_.policy; }
+
+private:
+	using clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief 周期任务
+	 *
+	 */
+	struct Job
+	{
+		TaskRef ref;					  ///< 任务引用
+		uint64_t tid;					  ///< 任务id
+		std::chrono::nanoseconds period;  ///< 周期
+		clock::time_point deadline;		  ///< 下次执行的截止时间
+		TaskFunction<void()> fn;		  ///< 任务调用
+		TaskPromise<void> done;			  ///< 任务结束通知
+		std::exception_ptr error;		  ///< 任务异常
+
+		Job(const TaskRef &ref, const uint64_t &tid, const std::chrono::nanoseconds &period,
+			TaskFunction<void()> &&fn, TaskPromise<void> &&done)
+			: ref(ref), tid(tid), period(period), deadline(clock::now() + period),
+			  fn(std::move(fn)), done(std::move(done)) {}
+	};
+
+	/**
+	 * @brief 定时项，截止时间变化后旧的定时项作废
+	 *
+	 */
+	struct Timer
+	{
+		clock::time_point deadline; ///< 截止时间
+		uint64_t tid;				///< 任务id
+
+		bool operator>(const Timer &other) const noexcept { return deadline > other.deadline; }
+	};
+
+private:
+	// 定时线程
+	void run(void);
+	// 执行一次，返回false时任务结束
+	bool fire(Job &job);
+	// 结束任务，需持有锁，期间会临时释放
+	void finish(std::unique_lock<std::mutex> &lock, const uint64_t &tid);
+
+private:
+	std::mutex mtx_;															  ///< 操作锁
+	std::condition_variable condition_;										  ///< 休眠唤醒
+	std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_; ///< 按截止时间排序
+	std::unordered_map<uint64_t, std::unique_ptr<Job>> jobs_;					  ///< 周期任务，只由定时线程删除
+	std::vector<uint64_t> stops_;												  ///< 待停止任务
+	bool exit_;																	  ///< 退出标记
+	TaskKey<void> key_;															  ///< 定时线程
+};
+
+} // namespace wotsen
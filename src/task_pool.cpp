@@ -0,0 +1,227 @@
+/**
+ * @file task_pool.cpp
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 任务池
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <thread>
+#include <stdexcept>
+#include "task_pool.h"
+#include "task_auto_manage.h"
+
+namespace wotsen
+{
+extern task_dbg_cb __dbg;
+
+// 当前线程所属任务池
+static thread_local TaskPool *tls_pool = nullptr;
+// 当前线程在任务池中的位置
+static thread_local uint32_t tls_index = 0;
+
+// 优先级转换为队列位置，0为最高
+static inline uint32_t pri_level(const enum task_priority &priority) noexcept
+{
+	int level = (e_max_task_pri_lv - priority) / (e_max_task_pri_lv - e_sys_task_pri_lv);
+
+	if (level < 0) return 0;
+	if (level >= TASK_POOL_PRI_LEVELS) return TASK_POOL_PRI_LEVELS - 1;
+
+	return static_cast<uint32_t>(level);
+}
+
+TaskAttribute TaskPool::default_attr(void)
+{
+	TaskAttribute attr;
+
+	attr.task_name = "task pool";
+	attr.stacksize = TASK_STACKSIZE(256);
+	attr.priority = e_fun_task_pri_lv;
+
+	return attr;
+}
+
+TaskPool::TaskPool(const uint32_t &threads, const TaskAttribute &attr)
+	: threads_(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+	  workers_(new TaskPoolWorker[threads_]),
+	  next_(0), sleepers_(0), stop_(false)
+{
+	for (uint32_t i = 0; i < threads_; i++)
+	{
+		workers_[i].size = 0;
+	}
+
+	TaskAttribute _attr = attr;
+
+	for (uint32_t i = 0; i < threads_; i++)
+	{
+		_attr.task_name = attr.task_name + " " + std::to_string(i);
+
+		workers_[i].key = new_task(_attr, [this, i]() { run(i); });
+
+		if (INVALID_TASK_ID == workers_[i].key.tid)
+		{
+			// 已创建的线程退出
+			threads_ = i;
+			shutdown();
+			throw std::runtime_error("create task pool failed.");
+		}
+	}
+}
+
+TaskPool::~TaskPool()
+{
+	shutdown();
+}
+
+void TaskPool::shutdown(void)
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		stop_ = true;
+	}
+
+	condition_.notify_all();
+
+	// 等待工作线程处理完剩余任务后退出
+	for (uint32_t i = 0; i < threads_; i++)
+	{
+		if (workers_[i].key.fut.valid()) workers_[i].key.fut.wait();
+	}
+}
+
+void TaskPool::push(const enum task_priority &priority, TaskFunction<void()> &&job)
+{
+	// 工作线程内提交放入自己的队列，否则轮流放入
+	uint32_t index = tls_pool == this ? tls_index : next_.fetch_add(1, std::memory_order_relaxed) % threads_;
+	TaskPoolWorker &worker = workers_[index];
+
+	{
+		std::unique_lock<std::mutex> lock(worker.mtx);
+		worker.jobs[pri_level(priority)].push_back(std::move(job));
+		worker.size.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	// 与run中休眠前的屏障配对：要么这里看到休眠线程，要么休眠线程看到本次计数
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+
+	// 有休眠线程才唤醒
+	if (sleepers_.load(std::memory_order_relaxed) > 0)
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		condition_.notify_one();
+	}
+}
+
+bool TaskPool::pop(const uint32_t &index, TaskFunction<void()> &job)
+{
+	TaskPoolWorker &worker = workers_[index];
+
+	if (0 == worker.size.load(std::memory_order_relaxed)) return false;
+
+	std::unique_lock<std::mutex> lock(worker.mtx);
+
+	for (auto &jobs : worker.jobs)
+	{
+		if (jobs.empty()) continue;
+
+		// 自己的队列后进先出，缓存更热
+		job = std::move(jobs.back());
+		jobs.pop_back();
+		worker.size.fetch_sub(1, std::memory_order_relaxed);
+
+		return true;
+	}
+
+	return false;
+}
+
+bool TaskPool::steal(const uint32_t &index, TaskFunction<void()> &job)
+{
+	// 按优先级从高到低，从其他线程队列头部窃取
+	for (uint32_t level = 0; level < TASK_POOL_PRI_LEVELS; level++)
+	{
+		for (uint32_t n = 1; n < threads_; n++)
+		{
+			TaskPoolWorker &victim = workers_[(index + n) % threads_];
+
+			if (0 == victim.size.load(std::memory_order_relaxed)) continue;
+
+			std::unique_lock<std::mutex> lock(victim.mtx);
+
+			if (victim.jobs[level].empty()) continue;
+
+			job = std::move(victim.jobs[level].front());
+			victim.jobs[level].pop_front();
+			victim.size.fetch_sub(1, std::memory_order_relaxed);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t TaskPool::pending(void) const noexcept
+{
+	size_t count = 0;
+
+	for (uint32_t i = 0; i < threads_; i++) count += workers_[i].size.load(std::memory_order_relaxed);
+
+	return count;
+}
+
+void TaskPool::run(const uint32_t &index)
+{
+	TaskFunction<void()> job;
+
+	tls_pool = this;
+	tls_index = index;
+
+	// 停止后处理完剩余任务再退出
+	for (;;)
+	{
+		if (pop(index, job) || steal(index, job))
+		{
+			// 任务异常不能结束工作线程，否则该线程队列中的任务只能被窃取
+			try
+			{
+				job();
+			}
+			catch (std::exception &e)
+			{
+				task_dbg("task pool worker [%u] job throw exception : %s.\n", index, e.what());
+			}
+			catch (...)
+			{
+				task_dbg("task pool worker [%u] job throw exception.\n", index);
+			}
+
+			job = nullptr;
+			continue;
+		}
+
+		sleepers_.fetch_add(1, std::memory_order_relaxed);
+
+		// 与push中的屏障配对
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		{
+			std::unique_lock<std::mutex> lock(mtx_);
+
+			while (!stop_ && 0 == pending()) condition_.wait(lock);
+		}
+
+		sleepers_.fetch_sub(1, std::memory_order_relaxed);
+
+		if (stop_ && 0 == pending()) break;
+	}
+
+	tls_pool = nullptr;
+}
+
+} // namespace wotsen
@@ -0,0 +1,114 @@
+/**
+ * @file task_pool.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 任务池
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <condition_variable>
+#include "task_utils.h"
+
+namespace wotsen
+{
+
+///< 任务池优先级数量，与task_priority一一对应
+#define TASK_POOL_PRI_LEVELS 6
+
+/**
+ * @brief 任务池工作线程
+ *
+ */
+struct alignas(64) TaskPoolWorker
+{
+	std::mutex mtx;												 ///< 队列锁
+	std::deque<TaskFunction<void()>> jobs[TASK_POOL_PRI_LEVELS]; ///< 各优先级任务队列
+	std::atomic<uint32_t> size;									 ///< 队列中任务数量，各线程独立计数，不共享全局计数
+	TaskKey<void> key;											 ///< 线程
+};
+
+/**
+ * @brief 任务池
+ *
+ * 每个工作线程持有自己的队列，工作线程内提交的任务放入自己的队列(后进先出)，
+ * 外部提交轮流放入各工作线程，空闲时从其他线程队列头部窃取，高优先级先执行。
+ * 适合大量短任务，不受任务管理监控。
+ */
+class TaskPool
+{
+public:
+	explicit TaskPool(const uint32_t &threads = 0, const TaskAttribute &attr = default_attr());
+	~TaskPool();
+
+	TaskPool(const TaskPool &) = delete;
+	TaskPool &operator=(const TaskPool &) = delete;
+
+public:
+	// 提交任务
+	template <typename F, typename... Args>
+	future_callback_type<F, Args...> submit(F &&f, Args &&... args)
+	{
+		return submit_priority(e_fun_task_pri_lv, std::forward<F>(f), std::forward<Args>(args)...);
+	}
+
+	// 按优先级提交任务
+	template <typename F, typename... Args>
+	future_callback_type<F, Args...>
+	submit_priority(const enum task_priority &priority, F &&f, Args &&... args)
+	{
+		TaskFunction<void()> job;
+		future_callback_type<F, Args...> ret = make_task_packaged(job, std::forward<F>(f), std::forward<Args>(args)...);
+
+		push(priority, std::move(job));
+
+		return ret;
+	}
+
+	// 提交不需要返回值的任务，不再打包
+	void post(TaskFunction<void()> &&job, const enum task_priority &priority = e_fun_task_pri_lv)
+	{
+		push(priority, std::move(job));
+	}
+
+	// 工作线程数量
+	uint32_t size(void) const noexcept { return threads_; }
+
+	// 等待中的任务数量，各工作线程队列之和
+	size_t pending(void) const noexcept;
+
+	// 默认线程属性
+	static TaskAttribute default_attr(void);
+
+private:
+	// 放入队列
+	void push(const enum task_priority &priority, TaskFunction<void()> &&job);
+	// 从自己的队列取任务
+	bool pop(const uint32_t &index, TaskFunction<void()> &job);
+	// 从其他线程窃取任务
+	bool steal(const uint32_t &index, TaskFunction<void()> &job);
+	// 工作线程
+	void run(const uint32_t &index);
+	// 停止工作线程
+	void shutdown(void);
+
+private:
+	uint32_t threads_;							 ///< 工作线程数量
+	std::unique_ptr<TaskPoolWorker[]> workers_;	 ///< 工作线程
+	std::atomic<uint32_t> next_;				 ///< 外部提交轮转位置
+	std::atomic<uint32_t> sleepers_;			 ///< 休眠的工作线程数量
+	std::atomic<bool> stop_;					 ///< 停止标记
+	std::mutex mtx_;							 ///< 休眠锁
+	std::condition_variable condition_;			 ///< 休眠唤醒
+};
+
+} // namespace wotsen
@@ -0,0 +1,291 @@
+/**
+ * @file task_reactor.cpp
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief IO事件分发
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "task.h"
+#include "task_reactor.h"
+#include "task_auto_manage.h"
+
+namespace wotsen
+{
+extern task_dbg_cb __dbg;
+
+///< 每次取出的最大事件数
+#define TASK_REACTOR_EVENTS 256
+
+///< 唤醒事件的注册序号
+#define TASK_REACTOR_WAKEUP 0
+
+TaskAttribute TaskReactor::default_attr(void)
+{
+	TaskAttribute attr;
+
+	attr.task_name = "task reactor";
+	attr.stacksize = TASK_STACKSIZE(256);
+	attr.priority = e_sys_task_pri_lv;
+
+	return attr;
+}
+
+TaskReactor::TaskReactor(TaskPool *pool, const TaskAttribute &attr)
+	: pool_(pool), epfd_(-1), evfd_(-1), next_id_(TASK_REACTOR_WAKEUP + 1), inflight_(0), stop_(false)
+{
+	epfd_ = epoll_create1(EPOLL_CLOEXEC);
+	evfd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+	struct epoll_event ev = {};
+
+	ev.events = EPOLLIN;
+	ev.data.u64 = TASK_REACTOR_WAKEUP;
+
+	if (epfd_ < 0 || evfd_ < 0 || epoll_ctl(epfd_, EPOLL_CTL_ADD, evfd_, &ev) < 0)
+	{
+		if (epfd_ >= 0) close(epfd_);
+		if (evfd_ >= 0) close(evfd_);
+
+		throw std::runtime_error("create task reactor failed.");
+	}
+
+	key_ = new_task(attr, [this]() { run(); });
+
+	if (INVALID_TASK_ID == key_.tid)
+	{
+		close(epfd_);
+		close(evfd_);
+
+		throw std::runtime_error("create task reactor failed.");
+	}
+}
+
+TaskReactor::~TaskReactor()
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		stop_ = true;
+	}
+
+	uint64_t one = 1;
+
+	// 唤醒epoll线程退出
+	if (write(evfd_, &one, sizeof(one)) < 0) {}
+
+	key_.fut.wait();
+
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		// 已提交的处理会访问本对象和epfd_，等其完成后再关闭
+		idle_.wait(lock, [this]() { return 0 == inflight_; });
+	}
+
+	close(epfd_);
+	close(evfd_);
+}
+
+bool TaskReactor::add_item(const int &fd, const uint32_t &events, const uint64_t &tid, TaskFunction<void(uint32_t)> &&handler)
+{
+	auto item = std::make_shared<TaskReactorItem>();
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	if (items_.count(fd)) return false;
+
+	item->fd = fd;
+	item->events = events;
+	item->tid = tid;
+	item->id = next_id_++;
+	item->handler = std::move(handler);
+
+	struct epoll_event ev = {};
+
+	ev.events = events | EPOLLONESHOT;
+	ev.data.u64 = item->id;
+
+	if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) < 0) return false;
+
+	items_[fd] = item;
+	ids_[item->id] = item;
+
+	return true;
+}
+
+bool TaskReactor::modify(const int &fd, const uint32_t &events)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	auto it = items_.find(fd);
+
+	if (items_.end() == it) return false;
+
+	TaskReactorItem *item = it->second.get();
+	struct epoll_event ev = {};
+
+	item->events = events;
+	ev.events = events | EPOLLONESHOT;
+	ev.data.u64 = item->id;
+
+	return 0 == epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev);
+}
+
+bool TaskReactor::remove(const int &fd)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	auto it = items_.find(fd);
+
+	if (items_.end() == it) return false;
+
+	epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+	ids_.erase(it->second->id);
+	items_.erase(it);
+
+	return true;
+}
+
+size_t TaskReactor::size(void)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	return items_.size();
+}
+
+void TaskReactor::rearm(TaskReactorItem *item)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	// 处理期间已移除
+	auto it = ids_.find(item->id);
+
+	if (ids_.end() == it) return;
+
+	struct epoll_event ev = {};
+
+	ev.events = item->events | EPOLLONESHOT;
+	ev.data.u64 = item->id;
+
+	epoll_ctl(epfd_, EPOLL_CTL_MOD, item->fd, &ev);
+}
+
+void TaskReactor::dispatch(const std::shared_ptr<TaskReactorItem> &item, const uint32_t &events)
+{
+	// 处理函数异常不能结束工作线程或反应器线程，也不能跳过重新注册，否则该fd不再触发
+	try
+	{
+		std::unique_lock<std::mutex> lock(item->mtx);
+
+		item->handler(events);
+	}
+	catch (std::exception &e)
+	{
+		task_dbg("reactor fd [%d] handler throw exception : %s.\n", item->fd, e.what());
+	}
+	catch (...)
+	{
+		task_dbg("reactor fd [%d] handler throw exception.\n", item->fd);
+	}
+
+	// 处理完成即为所属任务的心跳，任务已结束则移除
+	if (TASK_REACTOR_NO_OWNER != item->tid && !Task::task_progress(item->tid))
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		auto it = ids_.find(item->id);
+
+		if (ids_.end() != it)
+		{
+			epoll_ctl(epfd_, EPOLL_CTL_DEL, item->fd, nullptr);
+			items_.erase(item->fd);
+			ids_.erase(it);
+		}
+
+		return;
+	}
+
+	rearm(item.get());
+}
+
+void TaskReactor::run(void)
+{
+	struct epoll_event events[TASK_REACTOR_EVENTS];
+
+	for (;;)
+	{
+		int n = epoll_wait(epfd_, events, TASK_REACTOR_EVENTS, -1);
+
+		if (n < 0 && EINTR != errno) break;
+
+		for (int i = 0; i < n; i++)
+		{
+			uint64_t id = events[i].data.u64;
+
+			if (TASK_REACTOR_WAKEUP == id)
+			{
+				uint64_t cnt = 0;
+
+				if (read(evfd_, &cnt, sizeof(cnt)) < 0) {}
+
+				continue;
+			}
+
+			std::shared_ptr<TaskReactorItem> item;
+
+			{
+				std::unique_lock<std::mutex> lock(mtx_);
+
+				auto it = ids_.find(id);
+
+				// 已移除
+				if (ids_.end() == it) continue;
+
+				item = it->second;
+
+				if (pool_) inflight_++;
+			}
+
+			uint32_t ready = events[i].events;
+
+			if (pool_)
+			{
+				pool_->post([this, item, ready]() {
+					/**
+					 * @brief 处理结束计数，处理抛出异常时也执行
+					 *
+					 */
+					struct Done
+					{
+						TaskReactor *reactor;
+
+						~Done()
+						{
+							std::unique_lock<std::mutex> lock(reactor->mtx_);
+
+							if (0 == --reactor->inflight_) reactor->idle_.notify_all();
+						}
+					} done{this};
+
+					dispatch(item, ready);
+				});
+			}
+			else
+			{
+				dispatch(item, ready);
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(mtx_);
+
+		if (stop_) break;
+	}
+}
+
+} // namespace wotsen
@@ -0,0 +1,113 @@
+/**
+ * @file task_reactor.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief IO事件分发
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <unordered_map>
+#include <sys/epoll.h>
+#include "task_pool.h"
+
+namespace wotsen
+{
+
+///< 事件处理不属于任何任务
+#define TASK_REACTOR_NO_OWNER INVALID_TASK_ID
+
+/**
+ * @brief IO事件处理
+ *
+ */
+struct TaskReactorItem
+{
+	int fd;									 ///< 文件描述符
+	uint32_t events;						 ///< 关注的事件
+	uint64_t tid;							 ///< 所属任务
+	uint64_t id;							 ///< 注册序号
+	TaskFunction<void(uint32_t)> handler;	 ///< 事件处理，参数为就绪事件
+	std::mutex mtx;							 ///< 处理锁，同一fd的事件不并发处理
+};
+
+/**
+ * @brief IO事件分发
+ *
+ * 一个epoll线程等待所有fd，就绪事件提交到任务池处理，未指定任务池时在epoll线程上处理。
+ * fd以EPOLLONESHOT注册，处理完成后重新关注，同一fd的处理不会并发。
+ * 每次处理完成即为所属任务的一次心跳，所属任务结束后自动移除。
+ *
+ * 析构时等待已提交到任务池的处理完成后再关闭epoll。
+ *
+ * [NOTE]:fd应为非阻塞，处理中读写到EAGAIN为止；不能在本分发器的处理中析构本分发器
+ */
+class TaskReactor
+{
+public:
+	explicit TaskReactor(TaskPool *pool = nullptr, const TaskAttribute &attr = default_attr());
+	~TaskReactor();
+
+	TaskReactor(const TaskReactor &) = delete;
+	TaskReactor &operator=(const TaskReactor &) = delete;
+
+public:
+	/**
+	 * @brief 注册fd
+	 *
+	 * @param fd : 文件描述符
+	 * @param events : EPOLLIN/EPOLLOUT等
+	 * @param tid : 所属任务，处理完成时心跳，TASK_REACTOR_NO_OWNER为不属于任何任务
+	 * @param handler : 事件处理void(uint32_t events)
+	 * @return true : 成功
+	 * @return false : 已注册或epoll失败
+	 */
+	template <typename F>
+	bool add(const int &fd, const uint32_t &events, const uint64_t &tid, F &&handler)
+	{
+		return add_item(fd, events, tid, TaskFunction<void(uint32_t)>(std::forward<F>(handler)));
+	}
+
+	// 修改关注的事件
+	bool modify(const int &fd, const uint32_t &events);
+	// 移除fd，正在处理的事件会执行完
+	bool remove(const int &fd);
+
+	// 注册的fd数量
+	size_t size(void);
+
+	// 默认线程属性
+	static TaskAttribute default_attr(void);
+
+private:
+	// 添加处理
+	bool add_item(const int &fd, const uint32_t &events, const uint64_t &tid, TaskFunction<void(uint32_t)> &&handler);
+	// epoll线程
+	void run(void);
+	// 处理事件
+	void dispatch(const std::shared_ptr<TaskReactorItem> &item, const uint32_t &events);
+	// 重新关注事件
+	void rearm(TaskReactorItem *item);
+
+private:
+	TaskPool *pool_;														  ///< 处理任务池，为空时在epoll线程上处理
+	int epfd_;																  ///< epoll
+	int evfd_;																  ///< 唤醒epoll线程
+	uint64_t next_id_;														  ///< 注册序号，0保留给唤醒
+	std::mutex mtx_;														  ///< 注册锁
+	uint32_t inflight_;														  ///< 已提交到任务池未完成的处理
+	std::condition_variable idle_;											  ///< 处理全部完成
+	std::unordered_map<int, std::shared_ptr<TaskReactorItem>> items_;		  ///< 按fd索引
+	std::unordered_map<uint64_t, std::shared_ptr<TaskReactorItem>> ids_;	  ///< 按注册序号索引
+	bool stop_;																  ///< 停止标记
+	TaskKey<void> key_;														  ///< epoll线程
+};
+
+} // namespace wotsen
@@ -0,0 +1,144 @@
+/**
+ * @file task_stop.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 任务停止令牌
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <stop_token>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include "task_park.h"
+
+namespace wotsen
+{
+
+/**
+ * @brief 任务停止令牌
+ *
+ * 每个任务一个，task_exit或任务超时时请求停止。检测只是一次原子读，不查任务表，不产生系统调用。
+ * 阻塞等待可被停止请求唤醒：睡眠使用sleep_for/sleep_until，条件变量使用std::condition_variable_any
+ * 配合token()，文件描述符使用TaskStopEvent加入poll/epoll。
+ *
+ * [NOTE]:任务收到停止请求后应尽快返回，超过task_exit的超时时间仍未返回的线程任务会被强制取消
+ */
+class TaskStopToken
+{
+public:
+	TaskStopToken() noexcept = default;
+	explicit TaskStopToken(std::stop_token token) noexcept : token_(std::move(token)) {}
+
+public:
+	// 是否已请求停止
+	bool stop_requested(void) const noexcept { return token_.stop_requested(); }
+
+	// 是否可能被请求停止，不属于任何任务的空令牌为false
+	bool stop_possible(void) const noexcept { return token_.stop_possible(); }
+
+	// 标准停止令牌，用于std::condition_variable_any::wait和std::stop_callback
+	const std::stop_token &token(void) const noexcept { return token_; }
+
+	// 睡眠，请求停止时提前返回，返回false表示已请求停止
+	template <typename Rep, typename Period>
+	bool sleep_for(const std::chrono::duration<Rep, Period> &d) const
+	{
+		return sleep_until(std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::steady_clock::duration>(d));
+	}
+
+	// 睡眠到截止时间，请求停止时提前返回，返回false表示已请求停止
+	bool sleep_until(const std::chrono::steady_clock::time_point &deadline) const
+	{
+		if (!stop_possible())
+		{
+			std::this_thread::sleep_until(deadline);
+			return true;
+		}
+
+		TaskParker parker;
+		// 在请求停止的线程中执行，回调结束前本函数不会返回
+		std::stop_callback wake(token_, [&parker]() { parker.unpark(); });
+
+		// 睡眠不需要自旋
+		return !parker.park_until([this]() { return stop_requested(); }, deadline, 0);
+	}
+
+private:
+	std::stop_token token_; ///< 标准停止令牌
+};
+
+/**
+ * @brief 停止事件，请求停止后文件描述符可读
+ *
+ * 阻塞在poll/epoll上的任务将fd()加入监听集合，停止请求即可唤醒，无需超时轮询。
+ */
+class TaskStopEvent
+{
+public:
+	/**
+	 * @brief 创建停止事件
+	 *
+	 * @param stop : 停止令牌，已请求停止时创建后立即可读
+	 * @throw std::runtime_error : eventfd创建失败
+	 */
+	explicit TaskStopEvent(const TaskStopToken &stop) : fd_(open_fd()), wake_(stop.token(), Notify{fd_.fd}) {}
+
+	TaskStopEvent(const TaskStopEvent &) = delete;
+	TaskStopEvent &operator=(const TaskStopEvent &) = delete;
+
+public:
+	// 事件描述符，只读，不要关闭
+	int fd(void) const noexcept { return fd_.fd; }
+
+private:
+	/**
+	 * @brief 描述符，最后析构，保证回调不会写入已关闭的描述符
+	 *
+	 */
+	struct Fd
+	{
+		int fd;
+
+		~Fd() { close(fd); }
+	};
+
+	/**
+	 * @brief 停止通知
+	 *
+	 */
+	struct Notify
+	{
+		int fd;
+
+		void operator()(void) const noexcept
+		{
+			uint64_t one = 1;
+
+			// 计数器不会溢出，写失败也只是重复通知
+			[[maybe_unused]] ssize_t ret = write(fd, &one, sizeof(one));
+		}
+	};
+
+	static Fd open_fd(void)
+	{
+		int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+		if (fd < 0) throw std::runtime_error("create stop event failed");
+
+		return Fd{fd};
+	}
+
+private:
+	Fd fd_;							 ///< 事件描述符
+	std::stop_callback<Notify> wake_; ///< 停止时写入事件
+};
+
+} // namespace wotsen
@@ -0,0 +1,424 @@
+/**
+ * @file task_table.cpp
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 任务表
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <thread>
+#include <pthread.h>
+#include "task_table.h"
+
+namespace wotsen
+{
+
+// 最小索引容量位数
+static const uint32_t MIN_INDEX_BITS = 4;
+
+// tid散列，pthread_t为地址，低位区分度差，使用斐波那契散列取高位
+static inline uint64_t tid_hash(const uint64_t &tid, const uint32_t &bits) noexcept
+{
+	return ((tid ^ (tid >> 32)) * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+// 分片散列，与索引使用的高位无关，避免同一分片的tid在索引中聚集
+static inline uint64_t shard_hash(uint64_t key) noexcept
+{
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDull;
+	key ^= key >> 33;
+	key *= 0xC4CEB9FE1A85EC53ull;
+	key ^= key >> 33;
+
+	return key;
+}
+
+TaskTable::TaskTable(const uint32_t &capacity, const uint32_t &id)
+	: id_(id), seq_(0), index_(nullptr), slots_(nullptr), used_(0), size_(0), version_(0)
+{
+	index_.store(index_build(capacity), std::memory_order_release);
+	slots_grow(capacity);
+}
+
+TaskTable::~TaskTable()
+{
+}
+
+TaskIndex *TaskTable::index_build(const uint32_t &capacity)
+{
+	uint32_t bits = MIN_INDEX_BITS;
+
+	// 负载不超过1/2
+	while ((1ull << bits) < 2ull * capacity) bits++;
+
+	std::unique_ptr<TaskIndex> index(new TaskIndex);
+
+	index->bits = bits;
+	index->mask = (1ull << bits) - 1;
+	index->entries.reset(new TaskIndexEntry[1ull << bits]);
+
+	for (uint64_t i = 0; i <= index->mask; i++)
+	{
+		index->entries[i].tid.store(INVALID_TASK_ID, std::memory_order_relaxed);
+		index->entries[i].desc.store(nullptr, std::memory_order_relaxed);
+	}
+
+	indexes_.push_back(std::move(index));
+
+	return indexes_.back().get();
+}
+
+void TaskTable::slots_grow(const uint32_t &capacity)
+{
+	TaskSlots *old = slots_.load(std::memory_order_relaxed);
+	uint32_t used = used_.load(std::memory_order_relaxed);
+
+	if (old && old->capacity >= capacity) return;
+
+	std::unique_ptr<TaskSlots> slots(new TaskSlots);
+
+	slots->capacity = std::max(capacity, 1u);
+	slots->items.reset(new std::atomic<TaskDesc *>[slots->capacity]);
+
+	for (uint32_t i = 0; i < slots->capacity; i++)
+	{
+		slots->items[i].store(i < used ? old->items[i].load(std::memory_order_relaxed) : nullptr, std::memory_order_relaxed);
+	}
+
+	slots_all_.push_back(std::move(slots));
+	slots_.store(slots_all_.back().get(), std::memory_order_release);
+}
+
+void TaskTable::write_begin(void) noexcept
+{
+	seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+void TaskTable::write_end(void) noexcept
+{
+	seq_.store(seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void TaskTable::index_insert(TaskIndex *index, const uint64_t &tid, TaskDesc *desc) noexcept
+{
+	uint64_t i = tid_hash(tid, index->bits);
+
+	while (INVALID_TASK_ID != index->entries[i].tid.load(std::memory_order_relaxed))
+	{
+		i = (i + 1) & index->mask;
+	}
+
+	index->entries[i].desc.store(desc, std::memory_order_relaxed);
+	index->entries[i].tid.store(tid, std::memory_order_relaxed);
+}
+
+void TaskTable::index_remove(const uint64_t &tid) noexcept
+{
+	TaskIndex *index = index_.load(std::memory_order_relaxed);
+	uint64_t i = tid_hash(tid, index->bits);
+	uint64_t key;
+
+	for (;;)
+	{
+		key = index->entries[i].tid.load(std::memory_order_relaxed);
+
+		if (INVALID_TASK_ID == key) return;
+		if (tid == key) break;
+
+		i = (i + 1) & index->mask;
+	}
+
+	// 后移删除，不留墓碑
+	for (uint64_t j = i;;)
+	{
+		j = (j + 1) & index->mask;
+		key = index->entries[j].tid.load(std::memory_order_relaxed);
+
+		if (INVALID_TASK_ID == key) break;
+
+		uint64_t k = tid_hash(key, index->bits);
+
+		// k在(i, j]之间则无需移动
+		if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) continue;
+
+		index->entries[i].desc.store(index->entries[j].desc.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		index->entries[i].tid.store(key, std::memory_order_relaxed);
+		i = j;
+	}
+
+	index->entries[i].tid.store(INVALID_TASK_ID, std::memory_order_relaxed);
+	index->entries[i].desc.store(nullptr, std::memory_order_relaxed);
+}
+
+TaskDesc *TaskTable::alloc(void)
+{
+	TaskDesc *desc = nullptr;
+
+	if (free_.empty())
+	{
+		pool_.emplace_back();
+		desc = &pool_.back();
+		desc->gen = 0;
+		desc->home = id_;
+	}
+	else
+	{
+		desc = free_.front();
+		free_.pop_front();
+	}
+
+	desc->tid = INVALID_TASK_ID;
+	desc->slot.store(INVALID_TASK_SLOT, std::memory_order_relaxed);
+	desc->shard = id_;
+	desc->gen++;
+
+	return desc;
+}
+
+void TaskTable::release(TaskDesc *desc)
+{
+	free_.push_back(desc);
+}
+
+void TaskTable::insert(TaskDesc *desc)
+{
+	uint32_t used = used_.load(std::memory_order_relaxed);
+	uint32_t slot = used;
+
+	if (free_slots_.empty())
+	{
+		// 新槽，超出容量时翻倍
+		if (used >= slots_.load(std::memory_order_relaxed)->capacity) slots_grow(2 * used);
+	}
+	else
+	{
+		slot = free_slots_.back();
+		free_slots_.pop_back();
+	}
+
+	desc->slot.store(slot, std::memory_order_release);
+	desc->shard = id_;
+
+	// 先写槽再扩大遍历范围
+	slots_.load(std::memory_order_relaxed)->items[slot].store(desc, std::memory_order_release);
+
+	if (slot == used) used_.store(used + 1, std::memory_order_release);
+
+	size_.fetch_add(1, std::memory_order_relaxed);
+	version_.fetch_add(1, std::memory_order_release);
+
+	if (INVALID_TASK_ID == desc->tid) return;
+
+	write_begin();
+	index_insert(index_.load(std::memory_order_relaxed), desc->tid, desc);
+	write_end();
+}
+
+void TaskTable::unlink(TaskDesc *desc)
+{
+	if (INVALID_TASK_ID == desc->tid) return;
+
+	if (find(desc->tid) == desc)
+	{
+		write_begin();
+		index_remove(desc->tid);
+		write_end();
+	}
+
+	desc->tid = INVALID_TASK_ID;
+}
+
+void TaskTable::erase(TaskDesc *desc)
+{
+	unlink(desc);
+
+	uint32_t slot = desc->slot.load(std::memory_order_relaxed);
+
+	// 槽置空，其他任务位置不变
+	if (INVALID_TASK_SLOT != slot)
+	{
+		slots_.load(std::memory_order_relaxed)->items[slot].store(nullptr, std::memory_order_release);
+		free_slots_.push_back(slot);
+		desc->slot.store(INVALID_TASK_SLOT, std::memory_order_release);
+
+		size_.fetch_sub(1, std::memory_order_relaxed);
+		version_.fetch_add(1, std::memory_order_release);
+	}
+}
+
+void TaskTable::reserve(const uint32_t &capacity)
+{
+	TaskIndex *old = index_.load(std::memory_order_relaxed);
+
+	slots_grow(capacity);
+
+	if (old->mask + 1 >= 2ull * capacity) return;
+
+	TaskIndex *index = index_build(capacity);
+
+	for_each([&](TaskDesc *item) {
+		if (INVALID_TASK_ID != item->tid) index_insert(index, item->tid, item);
+	});
+
+	write_begin();
+	index_.store(index, std::memory_order_release);
+	write_end();
+}
+
+TaskDesc *TaskTable::find(const uint64_t &tid) const noexcept
+{
+	if (INVALID_TASK_ID == tid) return nullptr;
+
+	TaskDesc *desc = nullptr;
+	uint64_t seq = 0;
+
+	do
+	{
+		// 等待写结束
+		while ((seq = seq_.load(std::memory_order_acquire)) & 1) std::this_thread::yield();
+
+		const TaskIndex *index = index_.load(std::memory_order_acquire);
+		uint64_t i = tid_hash(tid, index->bits);
+
+		desc = nullptr;
+
+		for (uint64_t n = 0; n <= index->mask; n++, i = (i + 1) & index->mask)
+		{
+			uint64_t key = index->entries[i].tid.load(std::memory_order_relaxed);
+
+			if (tid == key)
+			{
+				desc = index->entries[i].desc.load(std::memory_order_relaxed);
+				break;
+			}
+
+			if (INVALID_TASK_ID == key) break;
+		}
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while (seq != seq_.load(std::memory_order_relaxed));
+
+	return desc;
+}
+
+TaskShards::TaskShards(const uint32_t &capacity) : count_(0)
+{
+	uint32_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+	uint32_t count = 1;
+
+	// 分片数量取不小于CPU数量的2的幂
+	while (count < cpus && count < TASK_TABLE_MAX_SHARDS) count <<= 1;
+
+	// 按平均容量初始化，分片不均时由发布前的reserve扩容
+	uint32_t each = std::max(capacity / count, 1u);
+
+	for (uint32_t i = 0; i < count; i++) shards_.emplace_back(new TaskShard(each, i));
+}
+
+size_t TaskShards::index(const uint64_t &tid) const noexcept
+{
+	return shard_hash(tid) & (shards_.size() - 1);
+}
+
+bool TaskShards::acquire(const size_t &count, const size_t &max_tasks) noexcept
+{
+	size_t used = count_.load(std::memory_order_relaxed);
+
+	do
+	{
+		if (used + count > max_tasks) return false;
+	} while (!count_.compare_exchange_weak(used, used + count, std::memory_order_relaxed));
+
+	return true;
+}
+
+TaskDesc *TaskShards::alloc(void)
+{
+	// 不同创建线程使用不同分片的描述符池
+	TaskShard &shard = *shards_[index(static_cast<uint64_t>(pthread_self()))];
+	std::unique_lock<std::mutex> lock(shard.mtx);
+
+	return shard.table.alloc();
+}
+
+void TaskShards::alloc(std::vector<TaskDesc *> &descs)
+{
+	TaskShard &shard = *shards_[index(static_cast<uint64_t>(pthread_self()))];
+	std::unique_lock<std::mutex> lock(shard.mtx);
+
+	for (auto &item : descs) item = shard.table.alloc();
+}
+
+bool TaskShards::erase(const TaskRef &ref)
+{
+	TaskDesc *desc = ref.task;
+
+	{
+		std::unique_lock<std::mutex> lock(shards_[desc->shard]->mtx);
+
+		// 期间已被其他路径移除
+		if (ref.gen != desc->gen.load(std::memory_order_relaxed) || INVALID_TASK_SLOT == desc->slot.load(std::memory_order_relaxed)) return false;
+
+		shards_[desc->shard]->table.erase(desc);
+	}
+
+	// 槽已置空，其他路径不会再移除，释放发布分片的锁后再归还描述符
+	release(desc);
+
+	return true;
+}
+
+size_t TaskShards::erase(const size_t &i, const std::vector<TaskRef> &refs)
+{
+	std::vector<TaskDesc *> erased;
+
+	if (refs.empty()) return 0;
+
+	erased.reserve(refs.size());
+
+	{
+		std::unique_lock<std::mutex> lock(shards_[i]->mtx);
+
+		for (auto &ref : refs)
+		{
+			TaskDesc *desc = ref.task;
+
+			// 期间已被其他路径移除，或不属于本分片
+			if (ref.gen != desc->gen.load(std::memory_order_relaxed) || INVALID_TASK_SLOT == desc->slot.load(std::memory_order_relaxed) || i != desc->shard) continue;
+
+			shards_[i]->table.erase(desc);
+			erased.push_back(desc);
+		}
+	}
+
+	for (auto desc : erased) release(desc);
+
+	return erased.size();
+}
+
+void TaskShards::release(TaskDesc *desc)
+{
+	TaskCall calls;
+
+	// 在任务锁内取出任务调用，其他路径取调用时也持有任务锁，不会执行到已析构的调用
+	{
+		std::unique_lock<std::mutex> lock(desc->mtx);
+
+		calls = std::move(desc->calls);
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(shards_[desc->home]->mtx);
+
+		shards_[desc->home]->table.release(desc);
+	}
+
+	count_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+} // namespace wotsen
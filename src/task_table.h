@@ -0,0 +1,222 @@
+/**
+ * @file task_table.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 任务表
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "task.h"
+
+namespace wotsen
+{
+
+// 未发布任务的位置
+static const uint32_t INVALID_TASK_SLOT = UINT32_MAX;
+
+///< 任务表分片数量上限
+#define TASK_TABLE_MAX_SHARDS 64
+
+/**
+ * @brief tid索引项
+ *
+ */
+struct TaskIndexEntry
+{
+	std::atomic<uint64_t> tid;		 ///< 任务id，INVALID_TASK_ID为空
+	std::atomic<TaskDesc *> desc;	 ///< 任务描述
+};
+
+/**
+ * @brief tid索引，开放寻址线性探测，负载不超过1/2
+ *
+ */
+struct TaskIndex
+{
+	uint32_t bits;								///< 容量位数
+	uint64_t mask;								///< 容量掩码
+	std::unique_ptr<TaskIndexEntry[]> entries; ///< 索引项
+};
+
+/**
+ * @brief 任务槽数组，任务发布后位置固定，移除时置空，读者无锁遍历
+ *
+ */
+struct TaskSlots
+{
+	uint32_t capacity;								  ///< 容量
+	std::unique_ptr<std::atomic<TaskDesc *>[]> items; ///< 任务，nullptr为空位
+};
+
+/**
+ * @brief 任务表
+ *
+ * [NOTE]:查找、遍历无锁，不增加引用计数；写操作需要由调用者持有所在分片的锁(TaskShard::mtx)。
+ * 描述符由任务表持有，释放后回收复用（先进先出，尽量推迟复用），内存生命周期与任务表一致，
+ * 因此查找得到的指针始终可访问，使用前需要校验desc->tid，复用时desc->gen加1。
+ * 任务id本身不重复：线程任务的id带线程运行代数(见posix_thread.cpp)，其他任务的id递增，过期的id查找不到任务。
+ * 槽数组扩容时发布新数组，旧数组保留到任务表析构，读者不需要等待宽限期。
+ * 遍历期间一直存在的任务恰好访问一次，遍历期间发布或移除的任务可能访问到也可能访问不到。
+ */
+class TaskTable
+{
+public:
+	TaskTable(const uint32_t &capacity, const uint32_t &id);
+	~TaskTable();
+
+	TaskTable(const TaskTable &) = delete;
+	TaskTable &operator=(const TaskTable &) = delete;
+
+public:
+	// 申请描述符
+	TaskDesc *alloc(void);
+	// 回收描述符，描述符需属于本表(desc->home)且已移除，任务调用由调用者释放
+	void release(TaskDesc *desc);
+	// 发布任务
+	void insert(TaskDesc *desc);
+	// 解除tid索引，描述符保留在任务表中等待任务管理清理
+	void unlink(TaskDesc *desc);
+	// 移除任务，描述符由所属的表回收
+	void erase(TaskDesc *desc);
+	// 扩容
+	void reserve(const uint32_t &capacity);
+
+	// 查找任务，无锁
+	TaskDesc *find(const uint64_t &tid) const noexcept;
+
+	// 遍历任务，无锁
+	template <typename F>
+	void for_each(F &&fn) const
+	{
+		const TaskSlots *slots = slots_.load(std::memory_order_acquire);
+		uint32_t used = std::min(used_.load(std::memory_order_acquire), slots->capacity);
+
+		for (uint32_t i = 0; i < used; i++)
+		{
+			TaskDesc *desc = slots->items[i].load(std::memory_order_acquire);
+
+			if (desc) fn(desc);
+		}
+	}
+
+	// 任务数量
+	size_t size(void) const noexcept { return size_.load(std::memory_order_relaxed); }
+	// 任务表版本，发布或移除任务时加1
+	uint64_t version(void) const noexcept { return version_.load(std::memory_order_acquire); }
+
+private:
+	// 写开始
+	void write_begin(void) noexcept;
+	// 写结束
+	void write_end(void) noexcept;
+
+	// 索引插入
+	void index_insert(TaskIndex *index, const uint64_t &tid, TaskDesc *desc) noexcept;
+	// 索引删除
+	void index_remove(const uint64_t &tid) noexcept;
+	// 建立索引
+	TaskIndex *index_build(const uint32_t &capacity);
+	// 槽数组扩容
+	void slots_grow(const uint32_t &capacity);
+
+private:
+	uint32_t id_;									   ///< 分片编号
+	std::atomic<uint64_t> seq_;						   ///< 写序号，奇数表示正在写
+	std::atomic<TaskIndex *> index_;				   ///< 当前索引
+	std::vector<std::unique_ptr<TaskIndex>> indexes_; ///< 所有索引，扩容后旧索引保留到任务表析构
+	std::deque<TaskDesc> pool_;						   ///< 描述符池
+	std::deque<TaskDesc *> free_;					   ///< 空闲描述符
+	std::atomic<TaskSlots *> slots_;				   ///< 当前槽数组
+	std::vector<std::unique_ptr<TaskSlots>> slots_all_; ///< 所有槽数组，扩容后旧数组保留到任务表析构
+	std::atomic<uint32_t> used_;					   ///< 已使用的槽范围
+	std::vector<uint32_t> free_slots_;				   ///< 空闲槽
+	std::atomic<size_t> size_;						   ///< 任务数量
+	std::atomic<uint64_t> version_;					   ///< 任务表版本
+};
+
+/**
+ * @brief 任务表分片
+ *
+ */
+struct TaskShard
+{
+	std::mutex mtx;				 ///< 分片写锁
+	TaskTable table;			 ///< 分片任务表
+	std::vector<TaskRef> joined; ///< 新加入的任务，等待任务管理接管
+	std::vector<TaskRef> quited; ///< 线程已退出的任务
+
+	TaskShard(const uint32_t &capacity, const uint32_t &id) : table(capacity, id) {}
+};
+
+/**
+ * @brief 分片任务表
+ *
+ * 任务按tid散列到分片，各分片独立加锁，创建和清理不同分片的任务互不阻塞。
+ * 描述符从创建线程对应的分片申请，发布到tid对应的分片，移除后归还申请时的分片。
+ * 同一时刻只持有一个分片锁，不会相互等待。
+ * 查找只访问tid对应的分片，无锁；遍历依次访问所有分片，无锁。
+ */
+class TaskShards
+{
+public:
+	explicit TaskShards(const uint32_t &capacity);
+
+	TaskShards(const TaskShards &) = delete;
+	TaskShards &operator=(const TaskShards &) = delete;
+
+public:
+	// 占用任务数量，超出上限返回false
+	bool acquire(const size_t &count, const size_t &max_tasks) noexcept;
+
+	// 申请描述符，从当前线程对应的分片申请，需已占用任务数量
+	TaskDesc *alloc(void);
+	// 批量申请描述符，一次加锁
+	void alloc(std::vector<TaskDesc *> &descs);
+	// 移除任务并回收描述符，ref已失效或已移除时返回false
+	bool erase(const TaskRef &ref);
+	// 批量移除第i个分片的任务，一次加锁，返回移除数量
+	size_t erase(const size_t &i, const std::vector<TaskRef> &refs);
+	// 回收未发布的描述符，锁外释放任务调用中捕获的资源
+	void release(TaskDesc *desc);
+
+	// 分片数量
+	size_t count(void) const noexcept { return shards_.size(); }
+	// 第i个分片
+	TaskShard &at(const size_t &i) noexcept { return *shards_[i]; }
+	// tid所在分片
+	TaskShard &of(const uint64_t &tid) noexcept { return *shards_[index(tid)]; }
+
+	// 查找任务，无锁
+	TaskDesc *find(const uint64_t &tid) const noexcept { return shards_[index(tid)]->table.find(tid); }
+
+	// 遍历任务，无锁
+	template <typename F>
+	void for_each(F &&fn) const
+	{
+		for (auto &shard : shards_) shard->table.for_each(fn);
+	}
+
+	// 任务数量，包含已申请未发布的任务
+	size_t size(void) const noexcept { return count_.load(std::memory_order_relaxed); }
+
+private:
+	// tid所在分片编号
+	size_t index(const uint64_t &tid) const noexcept;
+
+private:
+	std::vector<std::unique_ptr<TaskShard>> shards_; ///< 分片
+	std::atomic<size_t> count_;						 ///< 已占用任务数量
+};
+
+} // namespace wotsen
@@ -0,0 +1,153 @@
+/**
+ * @file task_timer.cpp
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 定时服务
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#include <ctime>
+#include <stdexcept>
+#include "task_timer.h"
+
+namespace wotsen
+{
+
+// 精确时间，与task_clock同一时间基准(CLOCK_MONOTONIC)
+static inline task_time_t precise_now(void) noexcept
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return task_time_t(task_clock::duration(static_cast<task_clock::rep>(ts.tv_sec) * 1000000000 + ts.tv_nsec));
+}
+
+// steady_clock同样基于CLOCK_MONOTONIC，直接转换
+static inline task_time_t to_task_time(const std::chrono::steady_clock::time_point &t) noexcept
+{
+	return task_time_t(std::chrono::duration_cast<task_clock::duration>(t.time_since_epoch()));
+}
+
+static inline std::chrono::steady_clock::time_point to_steady_time(const task_time_t &t) noexcept
+{
+	return std::chrono::steady_clock::time_point(
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(t.time_since_epoch()));
+}
+
+TaskAttribute TaskTimer::default_attr(void)
+{
+	TaskAttribute attr;
+
+	attr.task_name = "task timer";
+	attr.stacksize = TASK_STACKSIZE(256);
+	attr.priority = e_sys_task_pri_lv;
+
+	return attr;
+}
+
+TaskTimer::TaskTimer(TaskPool *pool, const std::chrono::nanoseconds &tick, const TaskAttribute &attr)
+	: pool_(pool),
+	  wheel_(precise_now(), tick > std::chrono::nanoseconds::zero() ? tick : TASK_MS(1)),
+	  wake_(task_time_t::min()), stop_(false)
+{
+	key_ = new_task(attr, [this]() { run(); });
+
+	if (INVALID_TASK_ID == key_.tid) throw std::runtime_error("create task timer failed.");
+}
+
+TaskTimer::~TaskTimer()
+{
+	{
+		std::unique_lock<std::mutex> lock(mtx_);
+		stop_ = true;
+	}
+
+	condition_.notify_one();
+
+	// 未到期的任务随时间轮销毁，返回值置为broken_promise
+	key_.fut.wait();
+}
+
+uint64_t TaskTimer::add(const std::chrono::steady_clock::time_point &when, TaskFunction<void()> &&job)
+{
+	task_time_t expire = to_task_time(when);
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	uint64_t id = wheel_.add(expire, std::move(job));
+
+	// 比定时线程的唤醒时间早才需要唤醒
+	if (expire < wake_)
+	{
+		wake_ = task_time_t::min();
+		condition_.notify_one();
+	}
+
+	return id;
+}
+
+bool TaskTimer::cancel(const uint64_t &id)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	// 取消后不用唤醒定时线程，到时间轮边界时自然跳过
+	return wheel_.cancel(id);
+}
+
+size_t TaskTimer::size(void)
+{
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	return wheel_.size();
+}
+
+void TaskTimer::run(void)
+{
+	std::vector<TaskFunction<void()>> expired;
+	std::unique_lock<std::mutex> lock(mtx_);
+
+	while (!stop_)
+	{
+		wheel_.advance(precise_now(), [&](TaskFunction<void()> &job) { expired.push_back(std::move(job)); });
+
+		if (!expired.empty())
+		{
+			// 执行期间新加入的定时项不需要唤醒
+			wake_ = task_time_t::min();
+			lock.unlock();
+
+			for (auto &job : expired)
+			{
+				if (pool_)
+				{
+					pool_->post(std::move(job));
+				}
+				else
+				{
+					job();
+				}
+			}
+
+			expired.clear();
+			lock.lock();
+			continue;
+		}
+
+		wake_ = wheel_.next_time();
+
+		// 按绝对时间休眠
+		if (task_time_t::max() == wake_)
+		{
+			condition_.wait(lock);
+		}
+		else
+		{
+			condition_.wait_until(lock, to_steady_time(wake_));
+		}
+	}
+}
+
+} // namespace wotsen
@@ -0,0 +1,106 @@
+/**
+ * @file task_timer.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 定时服务
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <condition_variable>
+#include "task_pool.h"
+#include "task_timer_wheel.h"
+
+namespace wotsen
+{
+
+/**
+ * @brief 定时任务
+ *
+ * @tparam T : 返回值类型
+ */
+template <typename T>
+struct TaskTimerKey
+{
+	TaskFuture<T> fut; ///< 返回值，取消后为broken_promise
+	uint64_t id;	   ///< 定时句柄，用于取消
+};
+
+/**
+ * @brief 定时服务
+ *
+ * 一个定时线程管理所有定时项，使用分层时间轮，插入、取消O(1)。
+ * 到期的任务提交到任务池执行，未指定任务池时在定时线程上直接执行。
+ *
+ * [NOTE]:在定时线程上执行的任务会推迟其他定时项，耗时任务应指定任务池
+ */
+class TaskTimer
+{
+public:
+	static constexpr uint64_t INVALID_TIMER = TimerWheel<TaskFunction<void()>>::INVALID_TIMER; ///< 无效句柄
+
+public:
+	explicit TaskTimer(TaskPool *pool = nullptr,
+					   const std::chrono::nanoseconds &tick = TASK_MS(1),
+					   const TaskAttribute &attr = default_attr());
+	~TaskTimer();
+
+	TaskTimer(const TaskTimer &) = delete;
+	TaskTimer &operator=(const TaskTimer &) = delete;
+
+public:
+	// 延时执行
+	template <typename F, typename... Args>
+	TaskTimerKey<callable_ret_type<F, Args...>>
+	schedule_after(const std::chrono::nanoseconds &delay, F &&f, Args &&... args)
+	{
+		return schedule_at(std::chrono::steady_clock::now() + delay, std::forward<F>(f), std::forward<Args>(args)...);
+	}
+
+	// 指定时间执行
+	template <typename F, typename... Args>
+	TaskTimerKey<callable_ret_type<F, Args...>>
+	schedule_at(const std::chrono::steady_clock::time_point &when, F &&f, Args &&... args)
+	{
+		TaskTimerKey<callable_ret_type<F, Args...>> ret;
+		TaskFunction<void()> job;
+
+		ret.fut = make_task_packaged(job, std::forward<F>(f), std::forward<Args>(args)...);
+		ret.id = add(when, std::move(job));
+
+		return ret;
+	}
+
+	// 取消定时，已到期或已取消返回false
+	bool cancel(const uint64_t &id);
+
+	// 等待到期的定时项数量
+	size_t size(void);
+
+	// 默认线程属性
+	static TaskAttribute default_attr(void);
+
+private:
+	// 添加定时项
+	uint64_t add(const std::chrono::steady_clock::time_point &when, TaskFunction<void()> &&job);
+	// 定时线程
+	void run(void);
+
+private:
+	TaskPool *pool_;							 ///< 执行任务池，为空时在定时线程上执行
+	std::mutex mtx_;							 ///< 时间轮锁
+	std::condition_variable condition_;			 ///< 休眠唤醒
+	TimerWheel<TaskFunction<void()>> wheel_;	 ///< 时间轮
+	task_time_t wake_;							 ///< 定时线程唤醒时间，运行中为最小值
+	bool stop_;									 ///< 停止标记
+	TaskKey<void> key_;							 ///< 定时线程
+};
+
+} // namespace wotsen
@@ -0,0 +1,343 @@
+/**
+ * @file task_timer_wheel.h
+ * @author 余王亮 (wotsen@outlook.com)
+ * @brief 分层时间轮
+ * @version 0.1
+ * @date 2026-10-17
+ *
+ * @copyright Copyright (c) 2020
+ *
+ */
+
+#pragma once
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include "task.h"
+
+namespace wotsen
+{
+
+/**
+ * @brief 分层时间轮
+ *
+ * 每层64个槽，共5层，以tick为精度，覆盖2^30个tick，超出范围的定时项放在最高层，级联时重新计算。
+ * 插入、取消O(1)，推进时只访问非空槽和层边界。
+ *
+ * [NOTE]:非线程安全，由持有者线程独占使用
+ *
+ * @tparam T : 定时项数据
+ */
+template <typename T>
+class TimerWheel
+{
+public:
+	using handle = uint64_t;					///< 定时项句柄，高32位为代数
+	static constexpr handle INVALID_TIMER = 0; ///< 无效句柄
+
+public:
+	TimerWheel(const task_time_t &start, const task_clock::duration &tick)
+		: start_(start), tick_(tick), current_(0), size_(0)
+	{
+		for (auto &level : levels_)
+		{
+			std::fill(std::begin(level.head), std::end(level.head), NIL);
+			level.bitmap = 0;
+		}
+	}
+
+	TimerWheel(const TimerWheel &) = delete;
+	TimerWheel &operator=(const TimerWheel &) = delete;
+
+public:
+	// 添加定时项
+	handle add(const task_time_t &expire, T data)
+	{
+		uint32_t idx = NIL;
+
+		if (free_.empty())
+		{
+			idx = static_cast<uint32_t>(nodes_.size());
+			nodes_.emplace_back();
+			nodes_[idx].gen = 1;
+		}
+		else
+		{
+			idx = free_.back();
+			free_.pop_back();
+		}
+
+		Node &node = nodes_[idx];
+
+		node.expire = to_tick(expire);
+		node.data = std::move(data);
+
+		link(idx);
+		size_++;
+
+		return (static_cast<uint64_t>(node.gen) << 32) | idx;
+	}
+
+	// 取消定时项，已到期或已取消返回false
+	bool cancel(const handle &h)
+	{
+		uint32_t idx = static_cast<uint32_t>(h);
+
+		if (idx >= nodes_.size() || nodes_[idx].gen != static_cast<uint32_t>(h >> 32) || NIL == nodes_[idx].level)
+		{
+			return false;
+		}
+
+		unlink(idx);
+		release(idx);
+
+		return true;
+	}
+
+	// 推进到now，回调所有到期项，返回到期数量
+	template <typename F>
+	size_t advance(const task_time_t &now, F &&fn)
+	{
+		uint64_t target = now > start_ ? (now - start_) / tick_ : 0;
+		size_t cnt = 0;
+
+		while (current_ <= target)
+		{
+			uint32_t idx = current_ & WHEEL_MASK;
+
+			// 进入新一轮，高层级联
+			if (0 == idx) cascade();
+
+			uint64_t bits = levels_[0].bitmap >> idx;
+
+			// 本轮剩余槽为空，跳到边界
+			if (0 == bits)
+			{
+				current_ = std::min((current_ | WHEEL_MASK) + 1, target + 1);
+				continue;
+			}
+
+			uint64_t t = current_ + __builtin_ctzll(bits);
+
+			if (t > target)
+			{
+				current_ = target + 1;
+				break;
+			}
+
+			current_ = t + 1;
+			cnt += expire(t & WHEEL_MASK, fn);
+		}
+
+		return cnt;
+	}
+
+	// 定时项数量
+	size_t size(void) const noexcept { return size_; }
+
+	// 下一次需要推进的时间（到期或级联），没有定时项返回task_time_t::max()
+	task_time_t next_time(void) const noexcept
+	{
+		if (0 == size_) return task_time_t::max();
+
+		uint32_t idx = current_ & WHEEL_MASK;
+
+		// 边界处先级联
+		if (0 == idx) return to_time(current_);
+
+		uint64_t bits = levels_[0].bitmap >> idx;
+
+		if (bits) return to_time(current_ + __builtin_ctzll(bits));
+
+		return to_time((current_ | WHEEL_MASK) + 1);
+	}
+
+private:
+	enum
+	{
+		WHEEL_BITS = 6,					///< 每层位数
+		WHEEL_SIZE = 1 << WHEEL_BITS,	///< 每层槽数
+		WHEEL_MASK = WHEEL_SIZE - 1,	///< 槽掩码
+		WHEEL_LEVELS = 5,				///< 层数
+	};
+
+	static constexpr uint32_t NIL = UINT32_MAX;
+
+	/**
+	 * @brief 定时项
+	 *
+	 */
+	struct Node
+	{
+		uint64_t expire; ///< 到期tick
+		uint32_t prev;	 ///< 前一项
+		uint32_t next;	 ///< 后一项
+		uint32_t gen;	 ///< 代数
+		uint32_t level;	 ///< 所在层，NIL为未使用
+		uint32_t slot;	 ///< 所在槽
+		T data;			 ///< 数据
+
+		Node() : expire(0), prev(NIL), next(NIL), gen(0), level(NIL), slot(0) {}
+	};
+
+	/**
+	 * @brief 时间轮层
+	 *
+	 */
+	struct Level
+	{
+		uint32_t head[WHEEL_SIZE]; ///< 槽链表头
+		uint64_t bitmap;		   ///< 非空槽位图
+	};
+
+private:
+	// 时间转换为tick，向上取整
+	uint64_t to_tick(const task_time_t &t) const noexcept
+	{
+		return t > start_ ? (t - start_ + tick_ - task_clock::duration(1)) / tick_ : 0;
+	}
+
+	task_time_t to_time(const uint64_t &tick) const noexcept
+	{
+		return start_ + tick * tick_;
+	}
+
+	// 按到期时间放入对应层和槽
+	void link(const uint32_t &idx) noexcept
+	{
+		Node &node = nodes_[idx];
+		uint64_t expire = std::max(node.expire, current_);
+		uint64_t delta = expire - current_;
+		uint32_t level = 0;
+
+		while (level < WHEEL_LEVELS - 1 && delta >= (1ull << (WHEEL_BITS * (level + 1)))) level++;
+
+		// 超出范围，放在最高层最远处
+		if (delta >= (1ull << (WHEEL_BITS * WHEEL_LEVELS)))
+		{
+			expire = current_ + (1ull << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+		}
+
+		uint32_t slot = (expire >> (WHEEL_BITS * level)) & WHEEL_MASK;
+		Level &l = levels_[level];
+
+		node.level = level;
+		node.slot = slot;
+		node.prev = NIL;
+		node.next = l.head[slot];
+
+		if (NIL != node.next) nodes_[node.next].prev = idx;
+
+		l.head[slot] = idx;
+		l.bitmap |= 1ull << slot;
+	}
+
+	// 移出槽
+	void unlink(const uint32_t &idx) noexcept
+	{
+		Node &node = nodes_[idx];
+		Level &l = levels_[node.level];
+
+		if (NIL != node.prev)
+		{
+			nodes_[node.prev].next = node.next;
+		}
+		else
+		{
+			l.head[node.slot] = node.next;
+		}
+
+		if (NIL != node.next) nodes_[node.next].prev = node.prev;
+
+		if (NIL == l.head[node.slot]) l.bitmap &= ~(1ull << node.slot);
+
+		node.level = NIL;
+	}
+
+	// 回收定时项
+	void release(const uint32_t &idx)
+	{
+		Node &node = nodes_[idx];
+
+		node.level = NIL;
+		node.data = T();
+		// 代数0保留给无效句柄
+		if (0 == ++node.gen) node.gen = 1;
+
+		free_.push_back(idx);
+		size_--;
+	}
+
+	// 高层当前槽下放
+	void cascade(void) noexcept
+	{
+		for (uint32_t level = 1; level < WHEEL_LEVELS; level++)
+		{
+			uint32_t idx = (current_ >> (WHEEL_BITS * level)) & WHEEL_MASK;
+			Level &l = levels_[level];
+			uint32_t i = l.head[idx];
+
+			l.head[idx] = NIL;
+			l.bitmap &= ~(1ull << idx);
+
+			while (NIL != i)
+			{
+				uint32_t next = nodes_[i].next;
+
+				link(i);
+				i = next;
+			}
+
+			if (0 != idx) break;
+		}
+	}
+
+	// 第0层槽到期，先全部取出再回调，回调中可以添加或取消定时项
+	template <typename F>
+	size_t expire(const uint32_t &slot, F &fn)
+	{
+		Level &l = levels_[0];
+		uint32_t i = l.head[slot];
+
+		l.head[slot] = NIL;
+		l.bitmap &= ~(1ull << slot);
+
+		expired_.clear();
+
+		while (NIL != i)
+		{
+			uint32_t next = nodes_[i].next;
+
+			expired_.push_back(std::move(nodes_[i].data));
+			release(i);
+			i = next;
+		}
+
+		std::vector<T> expired;
+
+		// 回调可能重入添加定时项，交换出来处理
+		expired.swap(expired_);
+
+		for (auto &item : expired) fn(item);
+
+		size_t cnt = expired.size();
+
+		expired.clear();
+		expired_.swap(expired);
+
+		return cnt;
+	}
+
+private:
+	task_time_t start_;				///< 起始时间
+	task_clock::duration tick_;		///< 精度
+	uint64_t current_;				///< 下一个待处理tick
+	Level levels_[WHEEL_LEVELS];	///< 各层
+	std::vector<Node> nodes_;		///< 定时项
+	std::vector<uint32_t> free_;	///< 空闲定时项
+	std::vector<T> expired_;		///< 到期项缓存
+	size_t size_;					///< 定时项数量
+};
+
+} // namespace wotsen
@@ -16,10 +16,45 @@
 namespace wotsen
 {
 
-bool _create_util_task(uint64_t *tid, const size_t &stacksize,
-						const int &priority, task_util_call fn, void *arg)
+#if TASK_NUMA_NODE_ANY != THREAD_NUMA_NODE_ANY
+#error TASK_NUMA_NODE_ANY defined not equal THREAD_NUMA_NODE_ANY
+#endif
+
+static_assert((int)e_task_sched_inherit == THREAD_SCHED_INHERIT, "e_task_sched_inherit != THREAD_SCHED_INHERIT");
+static_assert((int)e_task_sched_other == SCHED_OTHER, "e_task_sched_other != SCHED_OTHER");
+static_assert((int)e_task_sched_fifo == SCHED_FIFO, "e_task_sched_fifo != SCHED_FIFO");
+static_assert((int)e_task_sched_rr == SCHED_RR, "e_task_sched_rr != SCHED_RR");
+static_assert((int)e_task_sched_batch == SCHED_BATCH, "e_task_sched_batch != SCHED_BATCH");
+static_assert((int)e_task_sched_idle == SCHED_IDLE, "e_task_sched_idle != SCHED_IDLE");
+static_assert((int)e_task_sched_deadline == SCHED_DEADLINE, "e_task_sched_deadline != SCHED_DEADLINE");
+
+bool _create_util_task(uint64_t *tid, const TaskAttribute &attr, task_util_call fn, void *arg,
+						enum task_sched_policy *policy)
 {
-	return create_thread(tid, stacksize, priority, (thread_func)fn, arg);
+	struct thread_attr _attr;
+	int _policy = THREAD_SCHED_INHERIT;
+
+	_attr.stacksize = attr.stacksize;
+	_attr.priority = attr.priority;
+	_attr.affinity = attr.affinity;
+	_attr.numa_node = attr.numa_node;
+	_attr.policy = attr.policy;
+	_attr.nice = attr.nice;
+	_attr.dl_runtime = static_cast<uint64_t>(attr.dl_runtime.count());
+	_attr.dl_deadline = static_cast<uint64_t>(attr.dl_deadline.count());
+	_attr.dl_period = static_cast<uint64_t>(attr.dl_period.count());
+
+	if (!create_thread(tid, _attr, (thread_func)fn, arg, &_policy))
+	{
+		return false;
+	}
+
+	if (policy)
+	{
+		*policy = static_cast<enum task_sched_policy>(_policy);
+	}
+
+	return true;
 }
 
 // 获取任务id
@@ -46,7 +81,7 @@ void set_task_name(const char *name, const uint64_t &tid)
 }
 
 // 获取任务名
-std::string &&get_task_name(const uint64_t &tid)
+std::string get_task_name(const uint64_t &tid)
 {
 	return get_thread_name(tid);
 }
@@ -57,4 +92,24 @@ void kill_task(const uint64_t &tid)
 	release_thread(tid);
 }
 
+// 设置任务CPU亲和性
+bool set_task_affinity(const cpu_set_t &affinity, const uint64_t &tid)
+{
+	return set_thread_affinity(affinity, tid);
+}
+
+// 设置任务线程缓存
+void set_task_cache(const uint32_t &max_idle, const std::chrono::milliseconds &idle_timeout)
+{
+	set_thread_cache(max_idle, static_cast<uint32_t>(idle_timeout.count()));
+}
+
+// 获取任务线程缓存统计
+TaskCacheStat get_task_cache_stat(void)
+{
+	struct thread_cache_stat stat = get_thread_cache_stat();
+
+	return {stat.hits, stat.misses, stat.expired, stat.idle};
+}
+
 } // namespace wotsen
\ No newline at end of file
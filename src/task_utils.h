@@ -14,6 +14,8 @@
 #include <future>
 #include <string>
 #include <cinttypes>
+#include <sched.h>
+#include "task_future.h"
 
 namespace wotsen
 {
@@ -32,13 +34,28 @@ enum task_priority : int
 	e_min_task_pri_lv = 50,
 };
 
+/**
+ * @brief 任务调度策略
+ * 
+ */
+enum task_sched_policy : int
+{
+	e_task_sched_inherit = -1,	///< 继承创建者
+	e_task_sched_other = 0,		///< SCHED_OTHER，分时调度，使用nice
+	e_task_sched_fifo = 1,		///< SCHED_FIFO，实时，使用priority
+	e_task_sched_rr = 2,		///< SCHED_RR，实时，使用priority
+	e_task_sched_batch = 3,		///< SCHED_BATCH，后台批处理，使用nice
+	e_task_sched_idle = 5,		///< SCHED_IDLE，空闲时运行
+	e_task_sched_deadline = 6,	///< SCHED_DEADLINE，周期任务，使用dl_runtime/dl_deadline/dl_period
+};
+
 // 可调用对象返回类型
 template <typename F, typename... Args>
-using callable_ret_type = typename std::result_of<F(Args...)>::type;
+using callable_ret_type = std::invoke_result_t<F, Args...>;
 
 // 可调用对象返回值
 template <typename F, typename... Args>
-using future_callback_type = std::future<callable_ret_type<F, Args...>>;
+using future_callback_type = TaskFuture<callable_ret_type<F, Args...>>;
 
 /**
  * @brief 任务描述符
@@ -49,9 +66,10 @@ template <class T>
 class TaskKey
 {
 public:
-	std::future<T> fut;   ///< 返回值
+	TaskFuture<T> fut;	  ///< 返回值
 #define INVALID_TASK_ID 0 ///< 无效任务id
-	uint64_t tid;		  ///< 任务id
+	uint64_t tid;		  ///< 任务id，不透明值，见task_id()
+	enum task_sched_policy policy; ///< 实际使用的调度策略，没有实时调度权限时降级为e_task_sched_other
 };
 
 /**
@@ -65,31 +83,30 @@ struct TaskAttribute
 #define TASK_STACKSIZE(k) ((k)*1024) ///< 栈内存计算k
 	size_t stacksize;				 ///< 栈内存
 	enum task_priority priority;	 ///< 优先级
-};
-
-/**
- * @brief 任务属性扩展
- * 
- */
-struct TaskAttrEx
-{
-	TaskAttribute attr;			///< 基本属性
-	std::function<void()> task; ///< 可调对象
+	cpu_set_t affinity = {};		 ///< CPU亲和性，空集为不限制
+#define TASK_NUMA_NODE_ANY -1		 ///< 不指定NUMA节点
+	int numa_node = TASK_NUMA_NODE_ANY; ///< 优先NUMA节点，栈从该节点分配，亲和性为空时绑定到该节点的CPU
+	enum task_sched_policy policy = e_task_sched_inherit; ///< 调度策略
+	int nice = 0;					 ///< nice值，0为不修改
+	std::chrono::nanoseconds dl_runtime{0};	 ///< 每周期运行时间
+	std::chrono::nanoseconds dl_deadline{0}; ///< 相对截止时间，0时与周期相同
+	std::chrono::nanoseconds dl_period{0};	 ///< 周期
 };
 
 /*******************************************************/
 // 内部调用
-using task_util_call = void *(*)(TaskAttrEx *);
+using task_util_call = void *(*)(void *);
 
 // 内部任务创建
 bool _create_util_task(uint64_t *tid,
-					   const size_t &stacksize,
-					   const int &priority,
+					   const TaskAttribute &attr,
 					   task_util_call fn,
-					   void *arg = nullptr);
+					   void *arg = nullptr,
+					   enum task_sched_policy *policy = nullptr);
 /*******************************************************/
 
 // 获取任务id
+// [NOTE]:任务id是不透明值，不是pthread_t：高16位为线程运行代数，缓存线程每次复用递增，旧id随之失效，不能传给pthread接口
 uint64_t task_id(void);
 
 // 任务检测
@@ -100,52 +117,91 @@ void set_task_name(const std::string &name, const uint64_t &tid=INVALID_TASK_ID)
 void set_task_name(const char *name, const uint64_t &tid=INVALID_TASK_ID);
 
 // 获取任务名
-std::string &&get_task_name(const uint64_t &tid=INVALID_TASK_ID);
+std::string get_task_name(const uint64_t &tid=INVALID_TASK_ID);
 
 // 结束任务
 void kill_task(const uint64_t &tid);
 
-// 创建任务
-template <typename F, typename... Args>
-TaskKey<callable_ret_type<F, Args...>>
-new_task(const TaskAttribute &attr, F &&f, Args &&... args)
+// 设置任务CPU亲和性
+bool set_task_affinity(const cpu_set_t &affinity, const uint64_t &tid=INVALID_TASK_ID);
+
+/**
+ * @brief 任务线程缓存统计
+ * 
+ */
+struct TaskCacheStat
 {
-	TaskKey<callable_ret_type<F, Args...>> ret;
+	uint64_t hits;		///< 复用空闲线程次数
+	uint64_t misses;	///< 新建线程次数
+	uint64_t expired;	///< 空闲超时或超出上限退出的线程数
+	uint32_t idle;		///< 当前空闲线程数
+};
 
-	// 可调用对象封装为void(void)
-	auto task = std::make_shared<std::packaged_task<callable_ret_type<F, Args...>()>>(
-		std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+// 设置任务线程缓存，结束的任务线程按(栈大小, 调度策略, 优先级, nice, NUMA节点, CPU亲和性, deadline参数)缓存复用，max_idle为0时不缓存
+void set_task_cache(const uint32_t &max_idle, const std::chrono::milliseconds &idle_timeout);
 
-	// 获取未来值对象
-	ret.fut = task->get_future();
-	ret.tid = INVALID_TASK_ID;
+// 获取任务线程缓存统计
+TaskCacheStat get_task_cache_stat(void);
 
-	// 资源申请
-	TaskAttrEx *attr_ex = new TaskAttrEx;
-
-	attr_ex->attr = attr;
-	attr_ex->task = [task]() { (*task)(); };
+/**
+ * @brief 独立任务，属性、可调用对象和返回值在同一块内存
+ *
+ * @tparam R : 返回值类型
+ * @tparam F : 可调用对象
+ */
+template <typename R, typename F>
+class TaskUtilState : public TaskPackagedState<R, F>
+{
+public:
+	TaskUtilState(const TaskAttribute &attr, F &&fn) : TaskPackagedState<R, F>(std::move(fn)), attr_(attr) {}
 
-	auto _task_run = [](TaskAttrEx *attr_ex) -> void * {
-		set_task_name(attr_ex->attr.task_name);
+public:
+	// 线程入口，持有一个引用
+	static void *entry(void *arg)
+	{
+		auto state = static_cast<TaskUtilState *>(arg);
 
-		auto task = attr_ex->task;
+		set_task_name(state->attr_.task_name);
 
-		delete attr_ex;
+		TaskRunner runner(state);
 
-		task();
+		runner();
 
 		return (void *)0;
-	};
+	}
+
+private:
+	TaskAttribute attr_; ///< 任务属性
+};
+
+// 创建任务
+template <typename F, typename... Args>
+TaskKey<callable_ret_type<F, Args...>>
+new_task(const TaskAttribute &attr, F &&f, Args &&... args)
+{
+	using R = callable_ret_type<F, Args...>;
+	using B = decltype(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+	TaskKey<R> ret;
+
+	// 只申请一次内存，线程和返回值各持有一个引用
+	auto state = new TaskUtilState<R, B>(attr, std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+
+	ret.fut = TaskFuture<R>(state);
+	ret.tid = INVALID_TASK_ID;
+	ret.policy = e_task_sched_inherit;
+
+	state->ref();
 
 	// 创建线程
 	if (!_create_util_task(&ret.tid,
-							attr.stacksize,
-							attr.priority,
-							(task_util_call)_task_run,
-							attr_ex))
+							attr,
+							&TaskUtilState<R, B>::entry,
+							state,
+							&ret.policy))
 	{
-		delete attr_ex;
+		// 返回值置为broken_promise
+		TaskRunner runner(state);
 	}
 
 	return ret;